@@ -1,9 +1,10 @@
 #include "plugin.hpp"
 #include "EightFace.hpp"
-#include <functional>
-#include <mutex>
-#include <condition_variable>
+#include "helpers/TaskWorker.hpp"
+#include "helpers/LatencyHistogram.hpp"
 #include <random>
+#include <mutex>
+#include <atomic>
 
 namespace StoermelderPackOne {
 namespace EightFace {
@@ -77,8 +78,15 @@ struct EightFaceModule : Module {
 
 	/** [Stored to JSON] */
 	bool presetSlotUsed[NUM_PRESETS];
-	/** [Stored to JSON] */
-	json_t* presetSlot[NUM_PRESETS];
+	/** [Stored to JSON] Snapshots are immutable once stored and replaced by presetSlotSet(), threads other
+	 * than the worker's must access them by presetSlotGet() */
+	json_t* presetSlot[NUM_PRESETS] = {};
+	/** Incremented whenever the snapshot of a slot is replaced, a new snapshot might get the address of the old one */
+	std::atomic<uint32_t> presetSlotGeneration[NUM_PRESETS] = {};
+	/** Guards replacing the pointers of presetSlot, held for swapping and referencing only */
+	std::mutex presetSlotMutex;
+	/** [Stored to JSON] store snapshots in compact form, see EightFace::snapshotToCompact() */
+	bool snapshotCompact = false;
 
 	/** [Stored to JSON] */
 	int preset = 0;
@@ -102,16 +110,37 @@ struct EightFaceModule : Module {
 	int presetNext = -1;
 	float modeLight = 0;
 
-	std::mutex workerMutex;
-	std::condition_variable workerCondVar;
-	std::thread* worker;
-	Context* workerContext;
-	bool workerIsRunning = true;
-	bool workerDoProcess = false;
 	int workerPreset = -1;
-	ModuleWidget* workerModuleWidget;
 	bool workerGui = false;
 	ModuleWidget* workerGuiModuleWidget = NULL;
+	double workerGuiTime;
+
+	/** Recall of the armed slot prepared by processWorkerStage(), used on the worker-thread only */
+	int stagePreset = -1;
+	uint32_t stageGeneration;
+	size_t stageDataHash;
+	bool stageBypass;
+	std::vector<std::pair<int, float>> stageParams;
+
+	/** State of the module after the last recall in AUTO-mode, used for skipping unchanged write-backs */
+	int recallPreset = -1;
+	size_t recallParamHash;
+	bool recallBypass;
+	/** Hash of the data-blob last written to or read from the module by the worker, valid for the module
+	 * recallModuleId only. The data-blob is not serialized on a recall, as long as the lock of the engine
+	 * is not held this would race with the module. */
+	int64_t recallModuleId = -1;
+	size_t recallDataHash;
+
+	/** Recall and staging requested by presetLoad(), handed to taskWorker by dispatchWorker() */
+	std::atomic<int> dispatchPreset{-1};
+	std::atomic<ModuleWidget*> dispatchModuleWidget{NULL};
+	std::atomic<double> dispatchTime{0.0};
+	std::atomic<int> dispatchStage{-1};
+	TaskWorker taskWorker;
+
+	/** Time from the trigger until the module is restored */
+	LatencyHistogram recallLatency;
 
 	LongPressButton typeButtons[NUM_PRESETS];
 	dsp::SchmittTrigger slotTrigger;
@@ -138,30 +167,22 @@ struct EightFaceModule : Module {
 		lightDivider.setDivision(512);
 		buttonDivider.setDivision(4);
 		onReset();
-		workerContext = contextGet();
-		worker = new std::thread(&EightFaceModule::processWorker, this);
+		taskWorker.postTask([this]() { dispatchWorker(); });
 	}
 
 	~EightFaceModule() {
+		// Snapshots are in use while a recall is running
+		taskWorker.postStop();
+		taskWorker.wait();
 		for (int i = 0; i < NUM_PRESETS; i++) {
-			if (presetSlotUsed[i])
+			if (presetSlot[i])
 				json_decref(presetSlot[i]);
 		}
-
-		workerIsRunning = false;
-		workerDoProcess = true;
-		workerCondVar.notify_one();
-		worker->join();
-		workerContext = NULL;
-		delete worker;
 	}
 
 	void onReset() override {
 		for (int i = 0; i < NUM_PRESETS; i++) {
-			if (presetSlotUsed[i]) {
-				json_decref(presetSlot[i]);
-				presetSlot[i] = NULL;
-			}
+			presetSlotSet(i, NULL);
 			presetSlotUsed[i] = false;
 		}
 
@@ -169,6 +190,7 @@ struct EightFaceModule : Module {
 		presetCount = NUM_PRESETS;
 		presetPrev = -1;
 		presetNext = -1;
+		recallPreset = -1;
 		modelSlug = "";
 		pluginSlug = "";
 		realModelSlug = "";
@@ -391,28 +413,135 @@ struct EightFaceModule : Module {
 	}
 
 
-	void processWorker() {
-		contextSet(workerContext);
-		while (true) {
-			std::unique_lock<std::mutex> lock(workerMutex);
-			workerCondVar.wait(lock, std::bind(&EightFaceModule::workerDoProcess, this));
-			if (!workerIsRunning || workerPreset < 0) return;
-			if (ctrlMode == CTRLMODE::AUTO && presetPrev >= 0 && presetSlotUsed[presetPrev]) {
-				json_decref(presetSlot[presetPrev]);
-				presetSlot[presetPrev] = workerModuleWidget->toJson();
+	void processWorker(int p, ModuleWidget* mw, double recallTime) {
+		presetAutoSave(mw);
+		json_t* slotJ = presetSlotResolve(p);
+		if (!slotJ) return;
+		bool staged = stagePreset == p && stageGeneration == presetSlotGeneration[p];
+		stagePreset = -1;
+		// A complete deserialization is needed unless the module still holds the staged data-blob,
+		// changes of the data-blob made outside of 8FACE are not detected
+		Module* m = mw->module;
+		if (staged && m && m->id == recallModuleId && recallDataHash == stageDataHash && m->isBypassed() == stageBypass) {
+			paramsApply(m, stageParams);
+			recallLatency.add(system::getTime() - recallTime);
+			presetRecalled(m, p, slotJ, stageDataHash);
+		}
+		else {
+			mw->fromJson(slotJ);
+			recallLatency.add(system::getTime() - recallTime);
+			presetRecalled(m, p, slotJ);
+		}
+		json_decref(slotJ);
+	}
+
+	/**
+	 * Writes the module's state back to the previous slot in AUTO-mode. Nothing is written if the module
+	 * is unchanged since its recall. The state is written to the slot it was recalled from, which is not
+	 * the previous slot if the worker dropped a recall in between: nothing is written then.
+	 */
+	void presetAutoSave(ModuleWidget* mw) {
+		if (ctrlMode != CTRLMODE::AUTO || recallPreset < 0 || recallPreset != presetPrev) return;
+		int p = recallPreset;
+		if (!presetSlotUsed[p]) return;
+		Module* m = mw->module;
+		if (!m) return;
+		// Serialized by the engine holding its lock, the data-blob is compared on the result
+		json_t* moduleJ = mw->toJson();
+		if (!moduleJ) return;
+		size_t dataHash = hashJson(json_object_get(moduleJ, "data"));
+		bool changed = m->id != recallModuleId || dataHash != recallDataHash || json_is_true(json_object_get(moduleJ, "bypass")) != recallBypass || hashParams(m) != recallParamHash;
+		recallModuleId = m->id;
+		recallDataHash = dataHash;
+		if (changed) {
+			presetSlotSet(p, moduleJ);
+		}
+		else {
+			json_decref(moduleJ);
+		}
+	}
+
+	/** Keeps the module's state after a recall of slot p, the data-hash of the snapshot slotJ is computed if not given */
+	void presetRecalled(Module* m, int p, json_t* slotJ, size_t dataHash = 0) {
+		recallPreset = -1;
+		recallModuleId = -1;
+		if (!m) return;
+		recallDataHash = dataHash != 0 ? dataHash : hashJson(json_object_get(slotJ, "data"));
+		recallModuleId = m->id;
+		if (ctrlMode != CTRLMODE::AUTO) return;
+		recallParamHash = hashParams(m);
+		recallBypass = m->isBypassed();
+		recallPreset = p;
+	}
+
+	/**
+	 * Prepares the recall of the armed slot ahead of the trigger: the snapshot is parsed and its
+	 * data-blob hashed. Nothing is diffed against the module as it might change until the trigger,
+	 * which only compares hashes and sets the parameters. In AUTO-mode the write-back of the previous
+	 * slot still serializes the module on the trigger.
+	 */
+	void processWorkerStage(int p) {
+		uint32_t generation = presetSlotGeneration[p];
+		json_t* slotJ = presetSlotResolve(p);
+		if (!slotJ) return;
+		paramsFromJson(slotJ, stageParams);
+		stageDataHash = hashJson(json_object_get(slotJ, "data"));
+		stageBypass = json_boolean_value(json_object_get(slotJ, "bypass"));
+		json_decref(slotJ);
+		stageGeneration = generation;
+		stagePreset = p;
+	}
+
+	/** Returns a new reference to the snapshot of slot p or NULL, can be called from any thread */
+	json_t* presetSlotGet(int p) {
+		std::lock_guard<std::mutex> lock(presetSlotMutex);
+		json_t* slotJ = presetSlot[p];
+		if (slotJ) json_incref(slotJ);
+		return slotJ;
+	}
+
+	/** Replaces the snapshot of slot p by slotJ, takes its reference */
+	void presetSlotSet(int p, json_t* slotJ) {
+		json_t* oldJ;
+		{
+			std::lock_guard<std::mutex> lock(presetSlotMutex);
+			oldJ = presetSlot[p];
+			presetSlot[p] = slotJ;
+			presetSlotGeneration[p]++;
+		}
+		// Other threads might still hold a reference
+		if (oldJ) json_decref(oldJ);
+	}
+
+	/** Returns a new reference to the snapshot of slot p, a snapshot loaded in compact form is parsed on its first use */
+	json_t* presetSlotResolve(int p) {
+		json_t* slotJ = presetSlotGet(p);
+		json_t* resolvedJ = snapshotResolve(slotJ);
+		if (!resolvedJ) return slotJ;
+		{
+			std::lock_guard<std::mutex> lock(presetSlotMutex);
+			// Same content, so the generation is kept. The reference held keeps the address of
+			// slotJ from being reused, the slot has been replaced meanwhile if it doesn't match.
+			if (presetSlot[p] == slotJ) {
+				json_incref(resolvedJ);
+				presetSlot[p] = resolvedJ;
+				json_decref(slotJ);
 			}
-			workerModuleWidget->fromJson(presetSlot[workerPreset]);
-			workerDoProcess = false;
 		}
+		json_decref(slotJ);
+		return resolvedJ;
 	}
 
 	void processGui() {
 		if (workerGuiModuleWidget) {
-			if (ctrlMode == CTRLMODE::AUTO && presetPrev >= 0 && presetSlotUsed[presetPrev]) {
-				json_decref(presetSlot[presetPrev]);
-				presetSlot[presetPrev] = workerModuleWidget->toJson();
+			presetAutoSave(workerGuiModuleWidget);
+			json_t* slotJ = presetSlotResolve(workerPreset);
+			if (slotJ) {
+				workerGuiModuleWidget->fromJson(slotJ);
+				recallLatency.add(system::getTime() - workerGuiTime);
+				presetRecalled(workerGuiModuleWidget->module, workerPreset, slotJ);
+				json_decref(slotJ);
 			}
-			workerGuiModuleWidget->fromJson(presetSlot[workerPreset]);
 			workerGuiModuleWidget = NULL;
 		}
 	}
@@ -430,13 +559,16 @@ struct EightFaceModule : Module {
 				ModuleWidget* mw = APP->scene->rack->getModule(m->id);
 				if (mw) {
 					workerPreset = p;
+					double recallTime = system::getTime();
 					if (workerGui) {
+						workerGuiTime = recallTime;
 						workerGuiModuleWidget = mw;
 					}
 					else {
-						workerModuleWidget = mw;
-						workerDoProcess = true;
-						workerCondVar.notify_one();
+						dispatchModuleWidget = mw;
+						dispatchTime = recallTime;
+						dispatchPreset = p;
+						taskWorker.post();
 					}
 				}
 			}
@@ -444,6 +576,25 @@ struct EightFaceModule : Module {
 		else {
 			if (!presetSlotUsed[p]) return;
 			presetNext = p;
+			if (!workerGui) {
+				dispatchStage = p;
+				taskWorker.post();
+			}
+		}
+	}
+
+	/** Submits the recall and staging requested by presetLoad(), which might run on the engine-thread */
+	void dispatchWorker() {
+		int p = dispatchPreset.exchange(-1);
+		if (p >= 0) {
+			ModuleWidget* mw = dispatchModuleWidget;
+			double recallTime = dispatchTime;
+			taskWorker.work([=]() { processWorker(p, mw, recallTime); }, true);
+		}
+		int s = dispatchStage.exchange(-1);
+		if (s >= 0) {
+			// Don't replace a pending recall
+			taskWorker.workIfIdle([=]() { processWorkerStage(s); });
 		}
 	}
 
@@ -457,15 +608,14 @@ struct EightFaceModule : Module {
 		workerGui = it != guiModuleSlugs.end();
 
 		ModuleWidget* mw = APP->scene->rack->getModule(m->id);
-		if (presetSlotUsed[p]) json_decref(presetSlot[p]);
+		presetSlotSet(p, mw->toJson());
 		presetSlotUsed[p] = true;
-		presetSlot[p] = mw->toJson();
+		if (recallPreset == p) recallPreset = -1;
 	}
 
 	void presetClear(int p) {
-		if (presetSlotUsed[p])
-			json_decref(presetSlot[p]);
-		presetSlot[p] = NULL;
+		if (recallPreset == p) recallPreset = -1;
+		presetSlotSet(p, NULL);
 		presetSlotUsed[p] = false;
 		if (preset == p) preset = -1;
 		bool empty = true;
@@ -497,13 +647,25 @@ struct EightFaceModule : Module {
 		json_object_set_new(rootJ, "slotCvMode", json_integer((int)slotCvMode));
 		json_object_set_new(rootJ, "preset", json_integer(preset));
 		json_object_set_new(rootJ, "presetCount", json_integer(presetCount));
+		json_object_set_new(rootJ, "snapshotCompact", json_boolean(snapshotCompact));
 
 		json_t* presetsJ = json_array();
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			json_t* presetJ = json_object();
 			json_object_set_new(presetJ, "slotUsed", json_boolean(presetSlotUsed[i]));
-			if (presetSlotUsed[i]) {
-				json_object_set(presetJ, "slot", presetSlot[i]);
+			// The worker might replace the snapshot meanwhile
+			json_t* slotJ = presetSlotUsed[i] ? presetSlotGet(i) : NULL;
+			if (slotJ) {
+				if (snapshotCompact) {
+					json_object_set_new(presetJ, "slotCompact", snapshotToCompact(slotJ));
+				}
+				else {
+					// Snapshots loaded in compact form and not recalled yet are parsed for the output only
+					json_t* resolvedJ = snapshotResolve(slotJ);
+					if (resolvedJ) json_object_set_new(presetJ, "slot", resolvedJ);
+					else json_object_set(presetJ, "slot", slotJ);
+				}
+				json_decref(slotJ);
 			}
 			json_array_append_new(presetsJ, presetJ);
 		}
@@ -531,12 +693,10 @@ struct EightFaceModule : Module {
 		slotCvMode = (SLOTCVMODE)json_integer_value(json_object_get(rootJ, "slotCvMode"));
 		preset = json_integer_value(json_object_get(rootJ, "preset"));
 		presetCount = json_integer_value(json_object_get(rootJ, "presetCount"));
+		snapshotCompact = json_boolean_value(json_object_get(rootJ, "snapshotCompact"));
 
 		for (int i = 0; i < NUM_PRESETS; i++) {
-			if (presetSlotUsed[i]) {
-				json_decref(presetSlot[i]);
-				presetSlot[i] = NULL;
-			}
+			presetSlotSet(i, NULL);
 			presetSlotUsed[i] = false;
 		}
 
@@ -545,10 +705,23 @@ struct EightFaceModule : Module {
 		size_t presetIndex;
 		json_array_foreach(presetsJ, presetIndex, presetJ) {
 			presetSlotUsed[presetIndex] = json_boolean_value(json_object_get(presetJ, "slotUsed"));
-			presetSlot[presetIndex] = json_deep_copy(json_object_get(presetJ, "slot"));
+			json_t* slotCompactJ = json_object_get(presetJ, "slotCompact");
+			if (slotCompactJ) {
+				// The data-blob is parsed on the slot's first recall
+				json_t* slotJ = snapshotFromCompact(slotCompactJ);
+				if (!slotJ) {
+					WARN("8FACE: Snapshot of slot %d has an unknown format and has been dropped", (int)presetIndex + 1);
+					presetSlotUsed[presetIndex] = false;
+				}
+				presetSlotSet(presetIndex, slotJ);
+			}
+			else {
+				presetSlotSet(presetIndex, json_deep_copy(json_object_get(presetJ, "slot")));
+			}
 		}
 
 		presetPrev = -1;
+		recallPreset = -1;
 		if (preset >= presetCount)
 			preset = 0;
 
@@ -653,6 +826,9 @@ struct EightFaceWidgetTemplate : ModuleWidget {
 			&module->autoload,
 			false
 		));
+		menu->addChild(createBoolPtrMenuItem("Compact snapshots", "", &module->snapshotCompact));
+		menu->addChild(new MenuSeparator());
+		menu->addChild(createLatencyMenuItem("Recall latency", &module->recallLatency));
 	}
 
 	void onHoverKey(const event::HoverKey& e) override {
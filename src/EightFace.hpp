@@ -26,5 +26,138 @@ enum class AUTOLOAD {
 	LASTACTIVE = 2
 };
 
+/** Hash of a JSON-object, returns 0 for NULL */
+inline size_t hashJson(json_t* rootJ) {
+	if (!rootJ) return 0;
+	char* s = json_dumps(rootJ, JSON_COMPACT | JSON_SORT_KEYS);
+	if (!s) return 0;
+	size_t h = std::hash<std::string>{}(s);
+	free(s);
+	return h;
+}
+
+/** Hash of the values of a module's parameters */
+inline size_t hashParams(Module* m) {
+	size_t h = 0;
+	for (Param& p : m->params) {
+		h = h * 31 + std::hash<float>{}(p.getValue());
+	}
+	return h;
+}
+
+/** Reads the parameter values of a module's snapshot as pairs of parameter id and value */
+inline void paramsFromJson(json_t* moduleJ, std::vector<std::pair<int, float>>& params) {
+	params.clear();
+	json_t* paramsJ = json_object_get(moduleJ, "params");
+	json_t* paramJ;
+	size_t i;
+	json_array_foreach(paramsJ, i, paramJ) {
+		json_t* valueJ = json_object_get(paramJ, "value");
+		if (!valueJ) continue;
+		json_t* paramIdJ = json_object_get(paramJ, "id");
+		int paramId = paramIdJ ? json_integer_value(paramIdJ) : i;
+		params.push_back(std::make_pair(paramId, (float)json_number_value(valueJ)));
+	}
+}
+
+/** Sets the parameters of a module which differ from the snapshot's values */
+inline void paramsApply(Module* m, const std::vector<std::pair<int, float>>& params) {
+	for (const std::pair<int, float>& p : params) {
+		if (p.first < 0 || p.first >= (int)m->paramQuantities.size()) continue;
+		ParamQuantity* pq = m->paramQuantities[p.first];
+		if (pq->getImmediateValue() != p.second) {
+			pq->setImmediateValue(p.second);
+		}
+	}
+}
+
+/** Version of the compact snapshot format, stored in the header of "paramsBin" */
+const uint32_t SNAPSHOT_COMPACT_VERSION = 1;
+
+/**
+ * Encodes a module's snapshot in compact form: the parameter values are stored as binary block with
+ * a header of format version and count, the data-blob as compact JSON-string which is not parsed on loading.
+ */
+inline json_t* snapshotToCompact(json_t* slotJ) {
+	// A snapshot not recalled yet still holds its data-blob as string, which is kept by the copy
+	json_t* compactJ = json_copy(slotJ);
+	json_object_del(compactJ, "params");
+	json_object_del(compactJ, "data");
+
+	std::vector<float> values;
+	json_t* paramsJ = json_object_get(slotJ, "params");
+	json_t* paramJ;
+	size_t i;
+	json_array_foreach(paramsJ, i, paramJ) {
+		json_t* valueJ = json_object_get(paramJ, "value");
+		if (!valueJ) continue;
+		json_t* paramIdJ = json_object_get(paramJ, "id");
+		size_t paramId = paramIdJ ? json_integer_value(paramIdJ) : i;
+		if (paramId >= values.size()) values.resize(paramId + 1, NAN);
+		values[paramId] = json_number_value(valueJ);
+	}
+	uint32_t header[2] = { SNAPSHOT_COMPACT_VERSION, (uint32_t)values.size() };
+	std::vector<uint8_t> bin(sizeof(header) + values.size() * sizeof(float));
+	std::memcpy(bin.data(), header, sizeof(header));
+	std::memcpy(bin.data() + sizeof(header), values.data(), values.size() * sizeof(float));
+	json_object_set_new(compactJ, "paramsBin", json_string(string::toBase64(bin.data(), bin.size()).c_str()));
+
+	json_t* dataJ = json_object_get(slotJ, "data");
+	if (dataJ) {
+		char* s = json_dumps(dataJ, JSON_COMPACT | JSON_SORT_KEYS | JSON_REAL_PRECISION(9));
+		if (s) {
+			json_object_set_new(compactJ, "dataJson", json_string(s));
+			free(s);
+		}
+	}
+	return compactJ;
+}
+
+/**
+ * Restores a snapshot encoded by snapshotToCompact(), returns NULL for an unknown format version.
+ * The data-blob is kept as string until snapshotResolve() is called on the first recall.
+ */
+inline json_t* snapshotFromCompact(json_t* compactJ) {
+	const char* paramsBin = json_string_value(json_object_get(compactJ, "paramsBin"));
+	if (!paramsBin) return NULL;
+	std::vector<uint8_t> bin = string::fromBase64(paramsBin);
+	uint32_t header[2];
+	if (bin.size() < sizeof(header)) return NULL;
+	std::memcpy(header, bin.data(), sizeof(header));
+	if (header[0] != SNAPSHOT_COMPACT_VERSION || bin.size() < sizeof(header) + header[1] * sizeof(float)) return NULL;
+
+	json_t* slotJ = json_copy(compactJ);
+	json_object_del(slotJ, "paramsBin");
+	json_t* paramsJ = json_array();
+	for (uint32_t i = 0; i < header[1]; i++) {
+		float v;
+		std::memcpy(&v, bin.data() + sizeof(header) + i * sizeof(float), sizeof(float));
+		if (std::isnan(v)) continue;
+		json_t* paramJ = json_object();
+		json_object_set_new(paramJ, "value", json_real(v));
+		json_object_set_new(paramJ, "id", json_integer(i));
+		json_array_append_new(paramsJ, paramJ);
+	}
+	json_object_set_new(slotJ, "params", paramsJ);
+	return slotJ;
+}
+
+/** Parses the data-blob of a snapshot restored by snapshotFromCompact(), returns NULL if there is nothing to parse */
+inline json_t* snapshotResolve(json_t* slotJ) {
+	json_t* dataJsonJ = json_object_get(slotJ, "dataJson");
+	if (!dataJsonJ) return NULL;
+	json_t* resolvedJ = json_copy(slotJ);
+	json_object_del(resolvedJ, "dataJson");
+	json_error_t error;
+	json_t* dataJ = json_loads(json_string_value(dataJsonJ), 0, &error);
+	if (dataJ) {
+		json_object_set_new(resolvedJ, "data", dataJ);
+	}
+	else {
+		WARN("8FACE: Broken data in snapshot, line %d: %s", error.line, error.text);
+	}
+	return resolvedJ;
+}
+
 } // namespace EightFace
 } // namespace StoermelderPackOne
\ No newline at end of file
@@ -1,12 +1,16 @@
 #include "plugin.hpp"
 #include "digital.hpp"
 #include "helpers/TaskWorker.hpp"
+#include "helpers/WorkerPool.hpp"
+#include "helpers/LatencyHistogram.hpp"
 #include "components/MenuColorLabel.hpp"
 #include "components/MenuColorField.hpp"
 #include "ui/ModuleSelectProcessor.hpp"
 #include "EightFace.hpp"
 #include "EightFaceMk2Base.hpp"
 #include <random>
+#include <unordered_map>
+#include <atomic>
 
 namespace StoermelderPackOne {
 namespace EightFaceMk2 {
@@ -110,6 +114,12 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		std::string moduleName;
 		ModuleWidget* getModuleWidget() { return APP->scene->rack->getModule(moduleId); }
 		bool needsGuiThread = false;
+		/** Shared with the recall plans, which might outlive the binding */
+		std::shared_ptr<LatencyHistogram> latency = std::make_shared<LatencyHistogram>();
+		/** Hash of the data-blob last restored or stored by 8FACE, 0 if unknown, shared like latency */
+		std::shared_ptr<std::atomic<size_t>> dataHash = std::make_shared<std::atomic<size_t>>(0);
+		/** Widget of the module resolved on the UI-thread by boundModulesResolve(), NULL if not in the rack */
+		std::atomic<ModuleWidget*> mw{NULL};
 	};
 
 	/** [Stored to JSON] */
@@ -122,9 +132,40 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 	/** [Stored to JSON] */
 	NVGcolor boxColor;
 
-	dsp::RingBuffer<std::tuple<ModuleWidget*, json_t*>, 16> workerGuiQueue;
+	/** Resolved target of a snapshot */
+	struct RecallTarget {
+		EightFaceMk2Entry* entry;
+		ModuleWidget* mw;
+		std::shared_ptr<LatencyHistogram> latency;
+		std::shared_ptr<std::atomic<size_t>> dataHash;
+	};
+
+	/** Precompiled recall of a slot, reused as long as the slot's snapshots and the bound modules are unchanged */
+	struct RecallPlan {
+		uint32_t generation = 0;
+		const EightFaceMk2Entry* presetData = NULL;
+		size_t presetSize = 0;
+		std::vector<RecallTarget> targets;
+		std::vector<RecallTarget> guiTargets;
+	};
+
+	/** Recall plans of all slots including expanders, used on the worker-thread only */
+	RecallPlan recallPlan[NUM_PRESETS * (MAX_EXPANDERS + 1)];
+	std::unordered_map<int64_t, BoundModule*> recallPlanIndex;
+	/** Bumped whenever the bound modules, their widgets or the snapshots change, recall plans of an older generation are compiled again */
+	std::atomic<uint32_t> recallGeneration{1};
+
+	/** Modules restored on the GUI-thread: widget, snapshot, time of the trigger, latency of the module, last of the recall */
+	dsp::RingBuffer<std::tuple<ModuleWidget*, json_t*, double, std::shared_ptr<LatencyHistogram>, bool>, 16> workerGuiQueue;
+	/** Recall and staging requested by presetLoad(), handed to taskWorker by dispatchWorker() */
+	std::atomic<int> dispatchPreset{-1};
+	std::atomic<double> dispatchTime{0.0};
+	std::atomic<int> dispatchStage{-1};
 	TaskWorker taskWorker;
 
+	/** Time from the trigger until all bound modules are restored */
+	LatencyHistogram recallLatency;
+
 	EightFaceMk2Module() {
 		BASE::panelTheme = pluginSettings.panelThemeDefault;
 		Module::config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -149,13 +190,17 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		boundModulesDivider.setDivision(APP->engine->getSampleRate());
 		lightDivider.setDivision(512);
 		onReset();
+		taskWorker.postTask([this]() { dispatchWorker(); });
 	}
 
 	~EightFaceMk2Module() {
+		// Snapshots and bound modules are in use while a recall is running
+		taskWorker.postStop();
+		taskWorker.wait();
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			if (BASE::presetSlotUsed[i]) {
-				for (json_t* vJ : BASE::preset[i]) {
-					json_decref(vJ);
+				for (EightFaceMk2Entry& e : BASE::preset[i]) {
+					json_decref(e.moduleJ);
 				}
 			}
 		}
@@ -168,8 +213,8 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		inChange = true;
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			if (BASE::presetSlotUsed[i]) {
-				for (json_t* vJ : BASE::preset[i]) {
-					json_decref(vJ);
+				for (EightFaceMk2Entry& e : BASE::preset[i]) {
+					json_decref(e.moduleJ);
 				}
 				BASE::preset[i].clear();
 			}
@@ -180,6 +225,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			delete b;
 		}
 		boundModules.clear();
+		recallGeneration++;
 		inChange = false;
 
 		preset = -1;
@@ -455,6 +501,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		auto it = EightFace::guiModuleSlugs.find(std::make_tuple(b->pluginSlug, b->modelSlug));
 		b->needsGuiThread = it != EightFace::guiModuleSlugs.end();
 		boundModules.push_back(b);
+		recallGeneration++;
 	}
 
 	void bindModuleExpander() {
@@ -468,10 +515,8 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		for (int i = 0; i < presetTotal; i++) {
 			EightFaceMk2Slot* slot = expSlot(i);
 			for (auto it = std::begin(*slot->preset); it != std::end(*slot->preset); it++) {
-				json_t* idJ = json_object_get(*it, "id");
-				if (!idJ) continue;
-				int id = json_integer_value(idJ);
-				if (id == b->moduleId) {
+				if (it->moduleId == b->moduleId) {
+					json_decref(it->moduleJ);
 					slot->preset->erase(it);
 					break;
 				}
@@ -485,41 +530,134 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			}
 		}
 		delete b;
+		recallGeneration++;
+	}
+
+	/** Resolves the widgets of the bound modules, to be called on the UI-thread whenever modules have been added or removed */
+	void boundModulesResolve() {
+		for (BoundModule* b : boundModules) {
+			b->mw = b->getModuleWidget();
+		}
+		recallGeneration++;
 	}
 
-	void processWorker(int workerPreset) {
+	void processWorker(int workerPreset, double recallTime) {
 		if (workerPreset < 0) return;
 
 		EightFaceMk2Slot* slot = expSlot(workerPreset);
-		for (json_t* vJ : *slot->preset) {
-			json_t* idJ = json_object_get(vJ, "id");
-			if (!idJ) continue;
-			int64_t moduleId = json_integer_value(idJ);
-			std::string plugin = json_string_value(json_object_get(vJ, "plugin"));
-			std::string model = json_string_value(json_object_get(vJ, "model"));
-			for (BoundModule* b : boundModules) {
-				if (b->moduleId != moduleId) continue;
-				if (b->pluginSlug != plugin || b->modelSlug != model) break;
-				ModuleWidget* mw = b->getModuleWidget();
-				if (!mw) continue;
-
-				if (b->needsGuiThread) {
-					workerGuiQueue.push(std::make_tuple(mw, vJ));
-				}
-				else {
-					mw->fromJson(vJ);
-				}
-				break;
+		RecallPlan& plan = recallPlan[workerPreset];
+		if (!recallPlanValid(plan, slot->preset)) {
+			recallPlanCompile(plan, slot->preset);
+		}
+
+		size_t guiCount = 0;
+		for (RecallTarget& t : plan.guiTargets) {
+			if (t.mw) guiCount++;
+		}
+		bool guiPending = guiCount > 0;
+		for (RecallTarget& t : plan.guiTargets) {
+			if (!t.mw) continue;
+			// The recall completes with the last module restored on the GUI-thread
+			workerGuiQueue.push(std::make_tuple(t.mw, t.entry->moduleJ, recallTime, t.latency, --guiCount == 0));
+		}
+
+		// Restored one after the other, fromJson() takes the engine's lock exclusively anyway
+		for (RecallTarget& t : plan.targets) {
+			if (!t.mw) continue;
+			presetApply(t.mw, *t.entry, *t.dataHash);
+			t.latency->add(system::getTime() - recallTime);
+		}
+		if (!guiPending) {
+			recallLatency.add(system::getTime() - recallTime);
+		}
+	}
+
+	/**
+	 * Prepares the recall of the armed slot ahead of the trigger by compiling its plan, the snapshots
+	 * have been parsed when stored. The trigger only checks the plan's generation and compares the
+	 * hashes in presetApply(), no module is serialized or looked up.
+	 */
+	void processWorkerStage(int workerPreset) {
+		if (workerPreset < 0) return;
+
+		EightFaceMk2Slot* slot = expSlot(workerPreset);
+		RecallPlan& plan = recallPlan[workerPreset];
+		if (!recallPlanValid(plan, slot->preset)) {
+			recallPlanCompile(plan, slot->preset);
+		}
+	}
+
+	/**
+	 * Checks if a recall plan still matches the slot's snapshots and the modules in the rack. Nothing
+	 * is looked up, any change bumps recallGeneration.
+	 */
+	bool recallPlanValid(RecallPlan& plan, std::vector<EightFaceMk2Entry>* preset) {
+		return plan.generation == recallGeneration && plan.presetData == preset->data() && plan.presetSize == preset->size();
+	}
+
+	void recallPlanCompile(RecallPlan& plan, std::vector<EightFaceMk2Entry>* preset) {
+		// Changes during compilation are picked up by the next recall
+		plan.generation = recallGeneration;
+		recallPlanIndex.clear();
+		for (BoundModule* b : boundModules) {
+			recallPlanIndex[b->moduleId] = b;
+		}
+
+		plan.presetData = preset->data();
+		plan.presetSize = preset->size();
+		plan.targets.clear();
+		plan.guiTargets.clear();
+		for (EightFaceMk2Entry& e : *preset) {
+			if (e.moduleId < 0) continue;
+			auto it = recallPlanIndex.find(e.moduleId);
+			if (it == recallPlanIndex.end()) continue;
+			BoundModule* b = it->second;
+			if (b->pluginSlug != e.pluginSlug || b->modelSlug != e.modelSlug) continue;
+
+			// Missing modules are kept in the plan, the plan becomes invalid when they appear
+			RecallTarget t;
+			t.entry = &e;
+			t.mw = b->mw;
+			t.latency = b->latency;
+			t.dataHash = b->dataHash;
+			if (b->needsGuiThread) {
+				plan.guiTargets.push_back(t);
+			}
+			else {
+				plan.targets.push_back(t);
 			}
 		}
 	}
 
+	/** Restores a module from a snapshot. The complete snapshot is deserialized only if the
+	 * module's bypass-state or the data-blob last applied differ, otherwise changed parameters are
+	 * set directly. The module's data-blob is never serialized here, so changes of the data-blob made
+	 * outside of 8FACE are not detected.
+	 */
+	void presetApply(ModuleWidget* mw, EightFaceMk2Entry& e, std::atomic<size_t>& dataHash) {
+		Module* m = mw->module;
+		if (!m) return;
+		size_t h = dataHash;
+		// The data-blob last applied is unknown if the hash is 0
+		bool fromJson = h == 0 || h != e.dataHash || m->isBypassed() != e.bypass;
+		if (fromJson) {
+			mw->fromJson(e.moduleJ);
+		}
+		else {
+			EightFace::paramsApply(m, e.params);
+		}
+		dataHash = e.dataHash;
+	}
+
 	void processGui() {
 		while (!workerGuiQueue.empty()) {
 			auto t = workerGuiQueue.shift();
 			ModuleWidget* mw = std::get<0>(t);
 			json_t* vJ = std::get<1>(t);
 			mw->fromJson(vJ);
+			double latency = system::getTime() - std::get<2>(t);
+			std::get<3>(t)->add(latency);
+			if (std::get<4>(t)) recallLatency.add(latency);
 		}
 	}
 
@@ -533,20 +671,38 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 				preset = p;
 				presetNext = -1;
 				if (!*(slot->presetSlotUsed)) return;
-				taskWorker.work([=]() { processWorker(p); });
+				dispatchTime = system::getTime();
+				dispatchPreset = p;
+				taskWorker.post();
 			}
 		}
 		else {
 			if (!*(slot->presetSlotUsed)) return;
 			presetNext = p;
+			dispatchStage = p;
+			taskWorker.post();
+		}
+	}
+
+	/** Submits the recall and staging requested by presetLoad(), which might run on the engine-thread */
+	void dispatchWorker() {
+		int p = dispatchPreset.exchange(-1);
+		if (p >= 0) {
+			double recallTime = dispatchTime;
+			taskWorker.work([=]() { processWorker(p, recallTime); }, true);
+		}
+		int s = dispatchStage.exchange(-1);
+		if (s >= 0) {
+			// Don't replace a pending recall
+			taskWorker.workIfIdle([=]() { processWorkerStage(s); });
 		}
 	}
 
 	void presetSave(int p) {
 		EightFaceMk2Slot* slot = expSlot(p);
 		if (*(slot->presetSlotUsed)) {
-			for (json_t* vJ : *(slot->preset)) {
-				json_decref(vJ);
+			for (EightFaceMk2Entry& e : *(slot->preset)) {
+				json_decref(e.moduleJ);
 			}
 			slot->preset->clear();
 		}
@@ -556,21 +712,53 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			ModuleWidget* mw = b->getModuleWidget();
 			if (!mw) continue;
 			json_t* vJ = mw->toJson();
-			slot->preset->push_back(vJ);
+			EightFaceMk2Entry e(vJ);
+			presetShare(e);
+			slot->preset->push_back(e);
+			*b->dataHash = e.dataHash;
 		}
+		recallGeneration++;
 		preset = p;
 	}
 
+	/**
+	 * Replaces a new snapshot by an identical one already stored in any slot, or shares at least
+	 * the data-blob if an identical one exists. Keeps memory usage of large banks low.
+	 */
+	void presetShare(EightFaceMk2Entry& e) {
+		json_t* dataJ = json_object_get(e.moduleJ, "data");
+		for (int i = 0; i < presetTotal; i++) {
+			EightFaceMk2Slot* slot = expSlot(i);
+			for (EightFaceMk2Entry& f : *slot->preset) {
+				if (f.dataHash != e.dataHash || f.moduleJ == e.moduleJ) continue;
+				if (f.moduleId == e.moduleId && json_equal(f.moduleJ, e.moduleJ)) {
+					json_incref(f.moduleJ);
+					json_decref(e.moduleJ);
+					e.moduleJ = f.moduleJ;
+					return;
+				}
+				if (!dataJ) continue;
+				json_t* sharedJ = json_object_get(f.moduleJ, "data");
+				if (sharedJ == dataJ) continue;
+				if (sharedJ && json_equal(sharedJ, dataJ)) {
+					json_object_set(e.moduleJ, "data", sharedJ);
+					dataJ = sharedJ;
+				}
+			}
+		}
+	}
+
 	void presetClear(int p) {
 		EightFaceMk2Slot* slot = expSlot(p);
 		if (*(slot->presetSlotUsed)) {
-			for (json_t* vJ : *(slot->preset)) {
-				json_decref(vJ);
+			for (EightFaceMk2Entry& e : *(slot->preset)) {
+				json_decref(e.moduleJ);
 			}
 			slot->preset->clear();
 			*expSlotLabel(p) = "";
 		}
 		*(slot->presetSlotUsed) = false;
+		recallGeneration++;
 		if (preset == p) preset = -1;
 	}
 
@@ -595,8 +783,8 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 
 		EightFaceMk2Slot* targetSlot = expSlot(target);
 		if (*(targetSlot->presetSlotUsed)) {
-			for (json_t* vJ : *(targetSlot->preset)) {
-				json_decref(vJ);
+			for (EightFaceMk2Entry& e : *(targetSlot->preset)) {
+				json_decref(e.moduleJ);
 			}
 			targetSlot->preset->clear();
 		}
@@ -604,9 +792,11 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		*(targetSlot->presetSlotUsed) = true;
 		auto sourcePreset = sourceSlot->preset;
 		auto targetPreset = targetSlot->preset;
-		for (json_t* vJ : *sourcePreset) {
-			targetPreset->push_back(json_deep_copy(vJ));
+		for (EightFaceMk2Entry& e : *sourcePreset) {
+			json_incref(e.moduleJ);
+			targetPreset->push_back(e);
 		}
+		recallGeneration++;
 		if (preset == target) preset = -1;
 	}
 
@@ -749,6 +939,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 				boundModules.push_back(b);
 			}
 		}
+		recallGeneration++;
 		inChange = false;
 
 		BASE::idFixClearMap();
@@ -828,6 +1019,8 @@ struct EightFaceMk2Widget : ThemedModuleWidget<EightFaceMk2Module<NUM_PRESETS>>
 
 	ModuleOuterBoundsDrawerWidget<MODULE>* boxDrawer = NULL;
 	ModuleSelectProcessor moduleSelectProcessor;
+	size_t resolvedModuleCount = 0;
+	uint32_t resolvedGeneration = 0;
 
 	EightFaceMk2Widget(MODULE* module)
 		: ThemedModuleWidget<MODULE>(module, "EightFaceMk2") {
@@ -892,6 +1085,14 @@ struct EightFaceMk2Widget : ThemedModuleWidget<EightFaceMk2Module<NUM_PRESETS>>
 		if (BASE::module) {
 			moduleSelectProcessor.step();
 			BASE::module->lights[MODULE::LIGHT_LEARN].setBrightness(moduleSelectProcessor.isLearning());
+			// Widgets are created and deleted on the UI-thread, so the bound modules' widgets are resolved
+			// here once modules have been added or removed or the bindings have changed
+			size_t n = APP->engine->getNumModules();
+			if (n != resolvedModuleCount || module->recallGeneration != resolvedGeneration) {
+				module->boundModulesResolve();
+				resolvedModuleCount = n;
+				resolvedGeneration = module->recallGeneration;
+			}
 			module->processGui();
 		}
 		BASE::step();
@@ -1002,6 +1203,7 @@ struct EightFaceMk2Widget : ThemedModuleWidget<EightFaceMk2Module<NUM_PRESETS>>
 					Menu* menu = new Menu;
 					ModuleWidget* mw = b->getModuleWidget();
 					if (mw) menu->addChild(construct<CenterItem>(&MenuItem::text, "Center module", &CenterItem::mw, mw));
+					menu->addChild(createLatencyMenuItem("Recall latency", b->latency.get()));
 					menu->addChild(construct<UnbindItem>(&MenuItem::text, "Unbind", &UnbindItem::module, module, &UnbindItem::b, b));
 					return menu;
 				}
@@ -1080,6 +1282,7 @@ struct EightFaceMk2Widget : ThemedModuleWidget<EightFaceMk2Module<NUM_PRESETS>>
 		if (module->boundModules.size() > 0) {
 			menu->addChild(new MenuSeparator());
 			menu->addChild(construct<ModuleMenuItem>(&MenuItem::text, "Bound modules", &ModuleMenuItem::module, module));
+			menu->addChild(createLatencyMenuItem("Recall latency", &module->recallLatency));
 		}
 
 		menu->addChild(new MenuSeparator());
@@ -2,6 +2,7 @@
 #include "plugin.hpp"
 #include "digital.hpp"
 #include "helpers/StripIdFixModule.hpp"
+#include "EightFace.hpp"
 
 namespace StoermelderPackOne {
 namespace EightFaceMk2 {
@@ -23,11 +24,40 @@ enum class CTRLMODE {
 	WRITE
 };
 
+/** Snapshot of a single bound module, its parameters and the hash of its data-blob are split
+ * off when the snapshot is stored so a recall can skip the deserialization of the data-blob.
+ * Snapshots are immutable once stored, so identical snapshots and data-blobs are shared by reference.
+ */
+struct EightFaceMk2Entry {
+	/** Complete snapshot as returned by ModuleWidget::toJson(), a reference is owned by the slot */
+	json_t* moduleJ;
+	int64_t moduleId = -1;
+	std::string pluginSlug;
+	std::string modelSlug;
+	std::vector<std::pair<int, float>> params;
+	bool bypass = false;
+	size_t dataHash = 0;
+
+	/** Takes the reference of moduleJ, the data-blob is hashed unless its hash is given */
+	EightFaceMk2Entry(json_t* moduleJ, const size_t* dataHash = NULL) : moduleJ(moduleJ) {
+		json_t* idJ = json_object_get(moduleJ, "id");
+		if (idJ) moduleId = json_integer_value(idJ);
+		const char* pluginSlug = json_string_value(json_object_get(moduleJ, "plugin"));
+		if (pluginSlug) this->pluginSlug = pluginSlug;
+		const char* modelSlug = json_string_value(json_object_get(moduleJ, "model"));
+		if (modelSlug) this->modelSlug = modelSlug;
+
+		EightFace::paramsFromJson(moduleJ, params);
+		bypass = json_boolean_value(json_object_get(moduleJ, "bypass"));
+		this->dataHash = dataHash ? *dataHash : EightFace::hashJson(json_object_get(moduleJ, "data"));
+	}
+};
+
 struct EightFaceMk2Slot {
 	Param* param;
 	Light* lights;
 	bool* presetSlotUsed;
-	std::vector<json_t*>* preset;
+	std::vector<EightFaceMk2Entry>* preset;
 	LongPressButton* presetButton;
 };
 
@@ -39,7 +69,7 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 	/** [Stored to JSON] */
 	bool presetSlotUsed[NUM_PRESETS] = {false};
 	/** [Stored to JSON] */
-	std::vector<json_t*> preset[NUM_PRESETS];
+	std::vector<EightFaceMk2Entry> preset[NUM_PRESETS];
 	/** [Stored to JSON] */
 	std::string textLabel[NUM_PRESETS];
 
@@ -61,6 +91,8 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 		json_t* rootJ = json_object();
 		json_object_set_new(rootJ, "panelTheme", json_integer(EightFaceMk2Base<NUM_PRESETS>::panelTheme));
 
+		// Data-blobs are stored once and referenced by their hash from the snapshots
+		json_t* snapshotDataJ = json_object();
 		json_t* presetsJ = json_array();
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			json_t* presetJ = json_object();
@@ -68,14 +100,31 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 			json_object_set_new(presetJ, "textLabel", json_string(EightFaceMk2Base<NUM_PRESETS>::textLabel[i].c_str()));
 			if (EightFaceMk2Base<NUM_PRESETS>::presetSlotUsed[i]) {
 				json_t* slotJ = json_array();
-				for (size_t j = 0; j < EightFaceMk2Base<NUM_PRESETS>::preset[i].size(); j++) {
-					json_array_append(slotJ, EightFaceMk2Base<NUM_PRESETS>::preset[i][j]);
+				for (EightFaceMk2Entry& e : EightFaceMk2Base<NUM_PRESETS>::preset[i]) {
+					json_t* dataJ = json_object_get(e.moduleJ, "data");
+					if (!dataJ) {
+						json_array_append(slotJ, e.moduleJ);
+						continue;
+					}
+					std::string dataRef = string::f("%016llx", (unsigned long long)e.dataHash);
+					json_t* pooledJ = json_object_get(snapshotDataJ, dataRef.c_str());
+					if (pooledJ && pooledJ != dataJ && !json_equal(pooledJ, dataJ)) {
+						// Hash collision, keep the data-blob within the snapshot
+						json_array_append(slotJ, e.moduleJ);
+						continue;
+					}
+					if (!pooledJ) json_object_set(snapshotDataJ, dataRef.c_str(), dataJ);
+					json_t* moduleJ = json_copy(e.moduleJ);
+					json_object_del(moduleJ, "data");
+					json_object_set_new(moduleJ, "dataRef", json_string(dataRef.c_str()));
+					json_array_append_new(slotJ, moduleJ);
 				}
-				json_object_set(presetJ, "slot", slotJ);
+				json_object_set_new(presetJ, "slot", slotJ);
 			}
 			json_array_append_new(presetsJ, presetJ);
 		}
 		json_object_set_new(rootJ, "presets", presetsJ);
+		json_object_set_new(rootJ, "snapshotData", snapshotDataJ);
 
 		return rootJ;
 	}
@@ -83,6 +132,10 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 	void dataFromJson(json_t* rootJ) override {
 		panelTheme = json_integer_value(json_object_get(rootJ, "panelTheme"));
 
+		// Referenced data-blobs are copied once and shared by all snapshots, along with their hash
+		json_t* snapshotDataJ = json_object_get(rootJ, "snapshotData");
+		std::map<std::string, std::tuple<json_t*, size_t>> snapshotData;
+
 		json_t* presetsJ = json_object_get(rootJ, "presets");
 		json_t* presetJ;
 		size_t presetIndex;
@@ -96,10 +149,29 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 				json_t* vJ;
 				size_t j;
 				json_array_foreach(slotJ, j, vJ) {
-					preset[presetIndex].push_back(json_deep_copy(vJ));
+					json_t* moduleJ = json_deep_copy(vJ);
+					const char* dataRef = json_string_value(json_object_get(moduleJ, "dataRef"));
+					if (!dataRef) {
+						preset[presetIndex].push_back(EightFaceMk2Entry(moduleJ));
+						continue;
+					}
+					auto it = snapshotData.find(dataRef);
+					if (it == snapshotData.end()) {
+						json_t* dataJ = json_deep_copy(json_object_get(snapshotDataJ, dataRef));
+						it = snapshotData.emplace(dataRef, std::make_tuple(dataJ, EightFace::hashJson(dataJ))).first;
+					}
+					json_object_del(moduleJ, "dataRef");
+					json_t* dataJ = std::get<0>(it->second);
+					if (dataJ) json_object_set(moduleJ, "data", dataJ);
+					preset[presetIndex].push_back(EightFaceMk2Entry(moduleJ, &std::get<1>(it->second)));
 				}
 			}
 		}
+
+		for (auto& it : snapshotData) {
+			json_t* dataJ = std::get<0>(it.second);
+			if (dataJ) json_decref(dataJ);
+		}
 	}
 };
 
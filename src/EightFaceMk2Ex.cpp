@@ -48,8 +48,8 @@ struct EightFaceMk2ExModule : EightFaceMk2Base<NUM_PRESETS> {
 	~EightFaceMk2ExModule() {
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			if (BASE::presetSlotUsed[i]) {
-				for (json_t* vJ : BASE::preset[i]) {
-					json_decref(vJ);
+				for (EightFaceMk2Entry& e : BASE::preset[i]) {
+					json_decref(e.moduleJ);
 				}
 			}
 		}
@@ -58,8 +58,8 @@ struct EightFaceMk2ExModule : EightFaceMk2Base<NUM_PRESETS> {
 	void onReset() override { 
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			if (BASE::presetSlotUsed[i]) {
-				for (json_t* vJ : BASE::preset[i]) {
-					json_decref(vJ);
+				for (EightFaceMk2Entry& e : BASE::preset[i]) {
+					json_decref(e.moduleJ);
 				}
 				BASE::preset[i].clear();
 			}
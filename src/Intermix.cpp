@@ -14,7 +14,8 @@ enum SCENE_CV_MODE {
 	TRIG_FWD = 0,
 	VOLT = 8,
 	C4 = 9,
-	ARM = 7
+	ARM = 7,
+	MORPH = 10
 };
 
 enum IN_MODE {
@@ -52,6 +53,124 @@ enum OUT_MODE {
 	OM_OUT = 1
 };
 
+/** Linear fades of the crosspoints of a PORTS x PORTS matrix.
+ * Only crosspoints which are currently moving are kept in a compact list and stepped
+ * four at a time, a fade is retired as soon as it reaches its target.
+ */
+template < int PORTS >
+struct IntermixFader {
+	static const int SIZE = PORTS * PORTS;
+
+	/** Fade-in time in seconds */
+	float rise[SIZE];
+	/** Fade-out time in seconds */
+	float fall[SIZE];
+	/** Position of a crosspoint in the active list, -1 if not fading */
+	int slot[SIZE];
+
+	int activeCount = 0;
+	int activeIndex[SIZE];
+	alignas(16) float activeValue[SIZE];
+	alignas(16) float activeTarget[SIZE];
+	alignas(16) float activeDelta[SIZE];
+
+	IntermixFader() {
+		for (int k = 0; k < SIZE; k++) {
+			rise[k] = 1.f;
+			fall[k] = 1.f;
+			activeValue[k] = 0.f;
+			activeTarget[k] = 0.f;
+			activeDelta[k] = 0.f;
+		}
+		reset();
+	}
+
+	void reset() {
+		activeCount = 0;
+		for (int k = 0; k < SIZE; k++) {
+			slot[k] = -1;
+		}
+	}
+
+	void setRise(int i, int j, float rise) {
+		int k = i * PORTS + j;
+		if (this->rise[k] == rise) return;
+		this->rise[k] = rise;
+		int s = slot[k];
+		if (s >= 0 && activeDelta[s] > 0.f) activeDelta[s] = rise > 0.f ? 1.f / rise : 1.f;
+	}
+
+	void setFall(int i, int j, float fall) {
+		int k = i * PORTS + j;
+		if (this->fall[k] == fall) return;
+		this->fall[k] = fall;
+		int s = slot[k];
+		if (s >= 0 && activeDelta[s] < 0.f) activeDelta[s] = fall > 0.f ? -1.f / fall : -1.f;
+	}
+
+	/** Starts a fade of crosspoint i/j from its current value in `matrix` towards `target`. */
+	void trigger(float (*matrix)[PORTS], int i, int j, float target) {
+		int k = i * PORTS + j;
+		int s = slot[k];
+		float value = s >= 0 ? activeValue[s] : matrix[i][j];
+		float t = target > value ? rise[k] : fall[k];
+		if (value == target || t <= 0.f) {
+			set(matrix, i, j, target);
+			return;
+		}
+		if (s < 0) {
+			s = activeCount++;
+			slot[k] = s;
+			activeIndex[s] = k;
+			activeValue[s] = value;
+		}
+		activeTarget[s] = target;
+		activeDelta[s] = target > value ? 1.f / t : -1.f / t;
+	}
+
+	/** Sets crosspoint i/j immediately, an ongoing fade is cancelled. */
+	void set(float (*matrix)[PORTS], int i, int j, float value) {
+		int s = slot[i * PORTS + j];
+		if (s >= 0) retire(s);
+		matrix[i][j] = value;
+	}
+
+	inline void process(float (*matrix)[PORTS], float deltaTime) {
+		if (activeCount == 0) return;
+		for (int s = 0; s < activeCount; s += 4) {
+			simd::float_4 v = simd::float_4::load(&activeValue[s]);
+			simd::float_4 t = simd::float_4::load(&activeTarget[s]);
+			simd::float_4 d = simd::float_4::load(&activeDelta[s]);
+			v += d * deltaTime;
+			v = simd::ifelse(d > 0.f, simd::fmin(v, t), simd::fmax(v, t));
+			v.store(&activeValue[s]);
+		}
+		for (int s = 0; s < activeCount;) {
+			int k = activeIndex[s];
+			matrix[k / PORTS][k % PORTS] = activeValue[s];
+			if (activeValue[s] == activeTarget[s]) {
+				retire(s);
+			}
+			else {
+				s++;
+			}
+		}
+	}
+
+	inline void retire(int s) {
+		int last = activeCount - 1;
+		slot[activeIndex[s]] = -1;
+		if (s != last) {
+			activeIndex[s] = activeIndex[last];
+			activeValue[s] = activeValue[last];
+			activeTarget[s] = activeTarget[last];
+			activeDelta[s] = activeDelta[last];
+			slot[activeIndex[s]] = s;
+		}
+		activeCount--;
+	}
+};
+
 template < int PORTS >
 struct IntermixModule : Module, IntermixBase<PORTS> {
 	enum ParamIds {
@@ -88,6 +207,12 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 		alignas(16) float matrix[PORTS][PORTS];
 	};
 
+	struct MorphData {
+		alignas(16) float matrix[PORTS][PORTS];
+		alignas(16) float outputAt[PORTS];
+		alignas(16) float output[PORTS];
+	};
+
 	alignas(16) float currentMatrix[PORTS][PORTS];
 
 	/** [Stored to JSON] */
@@ -118,10 +243,18 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 
 	int sceneNext = -1;
 
+	/** [Stored to JSON] */
+	int morphScene;
+	/** Selected scene and its difference to the morph target, recalculated when one of them is edited */
+	MorphData morphBase;
+	MorphData morphDelta;
+	bool morphDirty = true;
+	bool morphActive = false;
+
 	/** [Stored to JSON] */
 	int channelCount = 1;
 
-	LinearFade fader[PORTS][PORTS][PORT_MAX_CHANNELS];
+	IntermixFader<PORTS> fader;
 	uint32_t fadeInTs[PORTS];
 	uint32_t fadeOutTs[PORTS];
 	//dsp::TSlewLimiter<simd::float_4> outputAtSlew[PORTS / 4];
@@ -178,19 +311,18 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 		sceneAtMode = true;
 		sceneCount = SCENE_MAX;
 		sceneLock = false;
+		morphScene = 1;
 		sceneSet(0);
+		morphUpdate();
 		Module::onReset();
 	}
 
 	void onRemove() override {
-		// hack for clearing the module-pointers on the expander-chain
-		Module* m = this;
-		while (m) {
-			if (m->model != modelIntermix && m->model != modelIntermixEnv && m->model != modelIntermixFade && m->model != modelIntermixGate) break;
-			m->rightExpander.producerMessage = NULL;
-			m->rightExpander.consumerMessage = NULL;
-			m = m->rightExpander.module;
-		}
+		updateExpanderChain<PORTS>(this, true);
+	}
+
+	void onExpanderChange(const ExpanderChangeEvent& e) override {
+		if (e.side == 1) updateExpanderChain<PORTS>(this);
 	}
 
 	void process(const ProcessArgs& args) override {
@@ -224,6 +356,9 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 					}
 					break;
 				}
+				case SCENE_CV_MODE::MORPH: {
+					break;
+				}
 			}
 		}
 
@@ -257,90 +392,129 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 				}
 			}
 
+			expProcessFade();
 			float f1 = params[PARAM_FADEIN].getValue();
 			float f2 = params[PARAM_FADEOUT].getValue();
 			for (int i = 0; i < PORTS; i++) {
 				bool fadeIn = ts - fadeInTs[i] > sceneDivider.getDivision() * 2;
 				bool fadeOut = ts - fadeOutTs[i] > sceneDivider.getDivision() * 2;
-				scenes[sceneSelected].output[i] = params[PARAM_OUTPUT + i].getValue() == 0.f ? OM_OUT : OM_OFF;
-				scenes[sceneSelected].outputAt[i] = params[PARAM_AT + i].getValue();
+				OUT_MODE o = params[PARAM_OUTPUT + i].getValue() == 0.f ? OM_OUT : OM_OFF;
+				float at = params[PARAM_AT + i].getValue();
+				if (o != scenes[sceneSelected].output[i] || at != scenes[sceneSelected].outputAt[i]) morphDirty = true;
+				scenes[sceneSelected].output[i] = o;
+				scenes[sceneSelected].outputAt[i] = at;
+				IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
 				for (int j = 0; j < PORTS; j++) {
 					float p = params[PARAM_MATRIX + j * PORTS + i].getValue();
-					for (int c = 0; c < channelCount; c++) {
-						if (fadeIn) fader[i][j][c].setRise(f1);
-						if (fadeOut) fader[i][j][c].setFall(f2);
-						if (p != scenes[sceneSelected].matrix[i][j] && p == 1.f) fader[i][j][c].triggerFadeIn();
-						if (p != scenes[sceneSelected].matrix[i][j] && p == 0.f) fader[i][j][c].triggerFadeOut();
+					if (fadeIn) fader.setRise(i, j, f1);
+					if (fadeOut) fader.setFall(i, j, f2);
+					if (mode != IN_MODE::IM_FADE) {
+						fader.set(currentMatrix, i, j, p);
+					}
+					else if (p != scenes[sceneSelected].matrix[i][j]) {
+						fader.trigger(currentMatrix, i, j, p);
 					}
+					if (p != scenes[sceneSelected].matrix[i][j]) morphDirty = true;
 					scenes[sceneSelected].matrix[i][j] = p;
-					IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
-					if (mode != IN_MODE::IM_FADE) currentMatrix[i][j] = p;
 				}
 			}
+
+			if (morphDirty && sceneMode == SCENE_CV_MODE::MORPH) {
+				morphUpdate();
+			}
+
+			// Expander
+			this->snapshotPublish(currentMatrix, channelCount);
 		}
 
-		// DSP processing
-		for (int c = 0; c < channelCount; c++) {
-			simd::float_4 out[PORTS / 4] = {};
+		// Only crosspoints with an ongoing fade are stepped, the gain is shared by all channels
+		fader.process(currentMatrix, args.sampleTime);
+
+		// Output gain and enable are identical for all channels
+		simd::float_4 outAt[PORTS];
+		simd::float_4 outEnabled[PORTS];
+		bool morph = sceneMode == SCENE_CV_MODE::MORPH && inputs[INPUT_SCENE].isConnected();
+		if (morphActive && !morph) {
+			// Leaving morph-mode, return to the selected scene
 			for (int i = 0; i < PORTS; i++) {
-				float v;
-				IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
+				for (int j = 0; j < PORTS; j++) {
+					fader.set(currentMatrix, i, j, scenes[sceneSelected].matrix[i][j]);
+				}
+			}
+		}
+		morphActive = morph;
+		if (morph) {
+			// Morph between the selected scene and the morph target: base + m * delta
+			simd::float_4 m = clamp(inputs[INPUT_SCENE].getVoltage() / 10.f, 0.f, 1.f);
+			for (int i = 0; i < PORTS; i++) {
+				for (int j = 0; j < PORTS; j += 4) {
+					simd::float_4 v = simd::float_4::load(&morphBase.matrix[i][j]) + m * simd::float_4::load(&morphDelta.matrix[i][j]);
+					v.store(&currentMatrix[i][j]);
+				}
+			}
+			for (int j = 0; j < PORTS; j += 4) {
+				simd::float_4 at = simd::float_4::load(&morphBase.outputAt[j]) + m * simd::float_4::load(&morphDelta.outputAt[j]);
+				simd::float_4 o = simd::float_4::load(&morphBase.output[j]) + m * simd::float_4::load(&morphDelta.output[j]);
+				for (int k = 0; k < 4; k++) {
+					outAt[j + k] = at[k];
+					outEnabled[j + k] = o[k];
+				}
+			}
+		}
+		else {
+			for (int j = 0; j < PORTS; j++) {
+				outAt[j] = scenes[sceneSelected].outputAt[j];
+				outEnabled[j] = scenes[sceneSelected].output[j] == OM_OUT ? 1.f : 0.f;
+			}
+		}
+
+		// DSP processing
+		// Input-modes are resolved once per sample, the matrix is applied on four channels at once
+		int activeCount = 0;
+		int activeInput[PORTS];
+		IN_MODE activeMode[PORTS];
+		for (int i = 0; i < PORTS; i++) {
+			IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
+			if (mode == IN_MODE::IM_OFF) continue;
+			if ((mode == IN_MODE::IM_DIRECT || mode == IN_MODE::IM_FADE) && !inputs[INPUT + i].isConnected()) continue;
+			activeInput[activeCount] = i;
+			activeMode[activeCount] = mode;
+			activeCount++;
+		}
+
+		for (int c = 0; c < channelCount; c += 4) {
+			simd::float_4 out[PORTS] = {};
+			for (int k = 0; k < activeCount; k++) {
+				int i = activeInput[k];
+				IN_MODE mode = activeMode[k];
 				switch (mode) {
-					case IN_MODE::IM_OFF:
-						continue;
 					case IN_MODE::IM_DIRECT:
-						if (!inputs[INPUT + i].isConnected()) continue;
-						v = inputs[INPUT + i].getPolyVoltage(c);
-						break;
-					case IN_MODE::IM_FADE:
-						if (!inputs[INPUT + i].isConnected()) continue;
-						v = inputs[INPUT + i].getPolyVoltage(c);
+					case IN_MODE::IM_FADE: {
+						simd::float_4 v = inputs[INPUT + i].getPolyVoltageSimd<simd::float_4>(c);
 						for (int j = 0; j < PORTS; j++) {
-							currentMatrix[i][j] = fader[i][j][c].process(args.sampleTime);
+							out[j] += v * currentMatrix[i][j];
 						}
 						break;
-					default:
-						v = (mode - 24) / 12.f;
+					}
+					default: {
+						simd::float_4 v = (mode - 24) / 12.f;
+						for (int j = 0; j < PORTS; j++) {
+							out[j] += v * currentMatrix[i][j];
+						}
 						break;
-				}
-
-				for (int j = 0; j < PORTS; j+=4) {
-					simd::float_4 v1 = simd::float_4::load(&currentMatrix[i][j]);
-					simd::float_4 v2 = v1 * simd::float_4(v);
-					out[j / 4] += v2;
+					}
 				}
 			}
 
-
-			// -- Standard code --
-			/*
-			for (int i = 0; i < PORTS; i++) {
-				float v = scenes[sceneSelected].output[i] == OM_OUT ? out[i / 4][i % 4] : 0.f;
-				if (outputClamp) v = clamp(v, -10.f, 10.f);
-				outputs[OUTPUT + i].setVoltage(v);
-			}
-			*/
-			// -- Standard code --
-
-			// -- SIMD code --
-			simd::float_4 oc = outputClamp;
-			for (int j = 0; j < PORTS; j+=4) {
+			for (int j = 0; j < PORTS; j++) {
 				// Check for OUT_MODE
-				simd::int32_4 o1 = simd::int32_4::load((int32_t*)&scenes[sceneSelected].output[j]);
-				simd::float_4 o2 = simd::float_4(o1 != 0) == -1.f;
-				out[j / 4] = simd::ifelse(o2, out[j / 4], simd::float_4::zero());
+				simd::float_4 v = out[j] * outEnabled[j];
 				// Clamp if outputClamp it set
-				out[j / 4] = simd::ifelse(oc == 1.f, simd::clamp(out[j / 4], -10.f, 10.f), out[j / 4]);
+				if (outputClamp) v = simd::clamp(v, -10.f, 10.f);
 				// Attenuverters
-				simd::float_4 at = simd::float_4::load(&scenes[sceneSelected].outputAt[j]);
-				//at = outputAtSlew[j / 4].process(args.sampleTime, at);
-				out[j / 4] *= at;
+				v *= outAt[j];
+				outputs[OUTPUT + j].setVoltageSimd(v, c);
 			}
-
-			for (int i = 0; i < PORTS; i++) {
-				outputs[OUTPUT + i].setVoltage(out[i / 4][i % 4], c);
-			}
-			// -- SIMD code --
 		}
 
 		for (int i = 0; i < PORTS; i++) {
@@ -386,18 +560,14 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 				lights[LIGHT_OUTPUT + i].setSmoothBrightness(v, s);
 			}
 		}
-
-		// Expander
-		rightExpander.producerMessage = (IntermixBase<PORTS>*)this;
-		rightExpander.messageFlipRequested = true;
 	}
 
 	inline void sceneSet(int scene) {
 		if (sceneSelected == scene) return;
 		if (scene < 0) return;
-		int scenePrevious = sceneSelected;
 		sceneSelected = std::min(scene, sceneCount - 1);
 		sceneNext = -1;
+		morphDirty = true;
 
 		for (int i = 0; i < SCENE_MAX; i++) {
 			params[PARAM_SCENE + i].setValue(i == sceneSelected);
@@ -419,14 +589,14 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 			if (sceneAtMode) {
 				params[PARAM_AT + i].setValue(scenes[sceneSelected].outputAt[i]);
 			}
+			IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
 			for (int j = 0; j < PORTS; j++) {
 				float p = scenes[sceneSelected].matrix[i][j];
 				params[PARAM_MATRIX + j * PORTS + i].setValue(p);
-				for (int c = 0; c < channelCount; c++) {
-					if (p != scenes[scenePrevious].matrix[i][j] && p == 1.f) fader[i][j][c].triggerFadeIn();
-					if (p != scenes[scenePrevious].matrix[i][j] && p == 0.f) fader[i][j][c].triggerFadeOut();
-				}
-				currentMatrix[i][j] = p;
+				if (mode == IN_MODE::IM_FADE)
+					fader.trigger(currentMatrix, i, j, p);
+				else
+					fader.set(currentMatrix, i, j, p);
 			}
 		}
 		/*
@@ -446,9 +616,12 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 				scenes[scene].matrix[i][j] = scenes[sceneSelected].matrix[i][j];
 			}
 		}
+		morphDirty = true;
 	}
 
 	void sceneReset() {
+		fader.reset();
+		morphDirty = true;
 		for (int i = 0; i < PORTS; i++) {
 			scenes[sceneSelected].input[i] = IN_MODE::IM_DIRECT;
 			scenes[sceneSelected].output[i] = OUT_MODE::OM_OUT;
@@ -459,9 +632,6 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 				scenes[sceneSelected].matrix[i][j] = 0.f;
 				params[PARAM_MATRIX + j * PORTS + i].setValue(0.f);
 				currentMatrix[i][j] = 0.f;
-				for (int c = 0; c < channelCount; c++) {
-					fader[i][j][c].reset(0.f);
-				}
 			}
 		}
 	}
@@ -469,30 +639,44 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 	void sceneSetCount(int count) {
 		sceneCount = count;
 		sceneSelected = std::min(sceneSelected, sceneCount - 1);
+		morphDirty = true;
 	}
 
-	typename IntermixBase<PORTS>::IntermixMatrix expGetCurrentMatrix() override {
-		return currentMatrix;
+	void morphSetScene(int scene) {
+		morphScene = scene;
+		morphDirty = true;
 	}
 
-	int expGetChannelCount() override { 
-		return channelCount;
+	void morphUpdate() {
+		morphDirty = false;
+		SceneData& a = scenes[sceneSelected];
+		SceneData& b = scenes[morphScene];
+		for (int i = 0; i < PORTS; i++) {
+			morphBase.outputAt[i] = a.outputAt[i];
+			morphDelta.outputAt[i] = b.outputAt[i] - a.outputAt[i];
+			morphBase.output[i] = a.output[i] == OM_OUT;
+			morphDelta.output[i] = float(b.output[i] == OM_OUT) - float(a.output[i] == OM_OUT);
+			for (int j = 0; j < PORTS; j++) {
+				morphBase.matrix[i][j] = a.matrix[i][j];
+				morphDelta.matrix[i][j] = b.matrix[i][j] - a.matrix[i][j];
+			}
+		}
 	}
 
-	void expSetFade(int i, float* fadeIn, float* fadeOut) override {
-		if (fadeIn) {
-			fadeInTs[i] = ts;
-			for (int j = 0; j < PORTS; j++) {
-				for (int c = 0; c < channelCount; c++) {
-					fader[i][j][c].setRise(fadeIn[j]);
+	void expProcessFade() {
+		for (int i = 0; i < PORTS; i++) {
+			if (this->expFadeInSet[i]) {
+				this->expFadeInSet[i] = false;
+				fadeInTs[i] = ts;
+				for (int j = 0; j < PORTS; j++) {
+					fader.setRise(i, j, this->expFadeIn[i][j]);
 				}
 			}
-		}
-		if (fadeOut) {
-			fadeOutTs[i] = ts;
-			for (int j = 0; j < PORTS; j++) {
-				for (int c = 0; c < channelCount; c++) {
-					fader[i][j][c].setFall(fadeOut[j]);
+			if (this->expFadeOutSet[i]) {
+				this->expFadeOutSet[i] = false;
+				fadeOutTs[i] = ts;
+				for (int j = 0; j < PORTS; j++) {
+					fader.setFall(i, j, this->expFadeOut[i][j]);
 				}
 			}
 		}
@@ -544,6 +728,7 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 		json_object_set_new(rootJ, "sceneAtMode", json_boolean(sceneAtMode));
 		json_object_set_new(rootJ, "sceneCount", json_integer(sceneCount));
 		json_object_set_new(rootJ, "sceneLock", json_boolean(sceneLock));
+		json_object_set_new(rootJ, "morphScene", json_integer(morphScene));
 		return rootJ;
 	}
 
@@ -595,14 +780,14 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 		if (sceneCountJ) sceneCount = json_integer_value(sceneCountJ);
 		json_t* sceneLockJ = json_object_get(rootJ, "sceneLock");
 		if (sceneLockJ) sceneLock = json_boolean_value(sceneLockJ);
+		json_t* morphSceneJ = json_object_get(rootJ, "morphScene");
+		if (morphSceneJ) morphScene = clamp((int)json_integer_value(morphSceneJ), 0, SCENE_MAX - 1);
+		morphUpdate();
 
+		fader.reset();
 		for (int i = 0; i < PORTS; i++) {
 			for (int j = 0; j < PORTS; j++) {
-				float v = scenes[sceneSelected].matrix[i][j];
-				currentMatrix[i][j] = v;
-				for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
-					fader[i][j][c].reset(v);
-				}
+				currentMatrix[i][j] = scenes[sceneSelected].matrix[i][j];
 			}
 		}
 	}
@@ -859,10 +1044,21 @@ struct IntermixWidget : ThemedModuleWidget<IntermixModule<8>> {
 				{ SCENE_CV_MODE::TRIG_FWD, "Trigger" },
 				{ SCENE_CV_MODE::VOLT, "0..10V" },
 				{ SCENE_CV_MODE::C4, "C4-G4" },
-				{ SCENE_CV_MODE::ARM, "Arm" }
+				{ SCENE_CV_MODE::ARM, "Arm" },
+				{ SCENE_CV_MODE::MORPH, "Morph" }
 			},
 			&module->sceneMode
 		));
+		menu->addChild(createSubmenuItem("Morph target scene", string::f("%02d", module->morphScene + 1),
+			[=](Menu* menu) {
+				for (int i = 0; i < SCENE_MAX; i++) {
+					menu->addChild(createCheckMenuItem(string::f("%02d", i + 1), "",
+						[=]() { return module->morphScene == i; },
+						[=]() { module->morphSetScene(i); }
+					));
+				}
+			}
+		));
 		menu->addChild(createBoolPtrMenuItem("Include input-mode in scenes", "", &module->sceneInputMode));
 		menu->addChild(createBoolPtrMenuItem("Include attenuverters in scenes", "", &module->sceneAtMode));
 		menu->addChild(createBoolPtrMenuItem("Limit output to -10..10V", "", &module->outputClamp));
@@ -1,16 +1,112 @@
 #pragma once
 #include "plugin.hpp"
+#include <atomic>
 
 namespace StoermelderPackOne {
 namespace Intermix {
 
+inline bool isIntermixModel(Model* model) {
+	return model == modelIntermix || model == modelIntermixEnv || model == modelIntermixFade || model == modelIntermixGate;
+}
+
 template<int PORTS>
 struct IntermixBase {
-    typedef float (*IntermixMatrix)[PORTS];
-	virtual IntermixMatrix expGetCurrentMatrix() { return NULL; }
-	virtual int expGetChannelCount() { return 0; }
-	virtual void expSetFade(int i, float* fadeIn, float* fadeOut) { }
+	typedef float (*IntermixMatrix)[PORTS];
+
+	struct Snapshot {
+		alignas(16) float currentMatrix[PORTS][PORTS];
+		int channelCount;
+	};
+
+	/** State of the matrix for the expanders, double-buffered and published by Intermix at scene rate */
+	Snapshot snapshot[2];
+	/** Incremented on every publish, the readable buffer is snapshot[snapshotId % 2].
+	 * Expanders run on other engine-threads, so the buffer is published with release-ordering. */
+	std::atomic<uint32_t> snapshotId{0};
+
+	/** Fade times requested by IntermixFade, consumed by Intermix at scene rate */
+	float expFadeIn[PORTS][PORTS];
+	float expFadeOut[PORTS][PORTS];
+	bool expFadeInSet[PORTS] = {};
+	bool expFadeOutSet[PORTS] = {};
+
+	void snapshotPublish(IntermixMatrix currentMatrix, int channelCount) {
+		uint32_t id = snapshotId.load(std::memory_order_relaxed);
+		Snapshot& s = snapshot[(id + 1) % 2];
+		for (int i = 0; i < PORTS; i++) {
+			for (int j = 0; j < PORTS; j++) {
+				s.currentMatrix[i][j] = currentMatrix[i][j];
+			}
+		}
+		s.channelCount = channelCount;
+		snapshotId.store(id + 1, std::memory_order_release);
+	}
+
+	uint32_t expGetSnapshotId() {
+		return snapshotId.load(std::memory_order_acquire);
+	}
+
+	const Snapshot& expGetSnapshot(uint32_t id) {
+		return snapshot[id % 2];
+	}
+
+	void expSetFade(int i, float* fadeIn, float* fadeOut) {
+		if (fadeIn) {
+			for (int j = 0; j < PORTS; j++) {
+				expFadeIn[i][j] = fadeIn[j];
+			}
+			expFadeInSet[i] = true;
+		}
+		if (fadeOut) {
+			for (int j = 0; j < PORTS; j++) {
+				expFadeOut[i][j] = fadeOut[j];
+			}
+			expFadeOutSet[i] = true;
+		}
+	}
 };
 
+template<int PORTS>
+struct IntermixExpander {
+	/** Intermix on the left end of the expander-chain, resolved on expander changes and removals only */
+	IntermixBase<PORTS>* master = NULL;
+};
+
+/** Resolves the Intermix-module for all expanders in the chain containing module m.
+ * Must be called from the engine thread, e.g. from onExpanderChange() or onRemove().
+ */
+template<int PORTS>
+void updateExpanderChain(Module* m, bool removed = false) {
+	// Find the leftmost module of the chain
+	while (m->model != modelIntermix && m->leftExpander.module && isIntermixModel(m->leftExpander.module->model)) {
+		m = m->leftExpander.module;
+	}
+
+	IntermixBase<PORTS>* master = NULL;
+	if (m->model == modelIntermix) {
+		if (!removed) master = dynamic_cast<IntermixBase<PORTS>*>(m);
+		m = m->rightExpander.module;
+	}
+
+	while (m && isIntermixModel(m->model) && m->model != modelIntermix) {
+		IntermixExpander<PORTS>* exp = dynamic_cast<IntermixExpander<PORTS>*>(m);
+		if (exp) exp->master = master;
+		m = m->rightExpander.module;
+	}
+}
+
+/** Clears the Intermix-module of all expanders right of the removed module m. Rack doesn't send an
+ * ExpanderChangeEvent to the neighbours of a removed module, so this must be called from onRemove().
+ */
+template<int PORTS>
+void expanderChainRemoved(Module* m) {
+	m = m->rightExpander.module;
+	while (m && isIntermixModel(m->model) && m->model != modelIntermix) {
+		IntermixExpander<PORTS>* exp = dynamic_cast<IntermixExpander<PORTS>*>(m);
+		if (exp) exp->master = NULL;
+		m = m->rightExpander.module;
+	}
+}
+
 } // namespace Intermix
-} // namespace StoermelderPackOne
\ No newline at end of file
+} // namespace StoermelderPackOne
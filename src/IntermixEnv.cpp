@@ -5,7 +5,7 @@ namespace StoermelderPackOne {
 namespace Intermix {
 
 template<int PORTS>
-struct IntermixEnvModule : Module {
+struct IntermixEnvModule : Module, IntermixExpander<PORTS> {
 	enum ParamIds {
 		NUM_PARAMS
 	};
@@ -25,6 +25,10 @@ struct IntermixEnvModule : Module {
 	/** [Stored to JSON] */
 	int input;
 
+	/** snapshotId of the last processed state */
+	uint32_t snapshotId = 0;
+	int lastInput = -1;
+
 	IntermixEnvModule() {
 		panelTheme = pluginSettings.panelThemeDefault;
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -38,16 +42,25 @@ struct IntermixEnvModule : Module {
 		input = 0;
 	}
 
+	void onExpanderChange(const ExpanderChangeEvent& e) override {
+		updateExpanderChain<PORTS>(this);
+	}
+
+	void onRemove() override {
+		expanderChainRemoved<PORTS>(this);
+	}
+
 	void process(const ProcessArgs& args) override {
 		// Expander
-		Module* exp = leftExpander.module;
-		if (!exp || (exp->model != modelIntermix && exp->model != modelIntermixGate && exp->model != modelIntermixEnv && exp->model != modelIntermixFade) || !exp->rightExpander.consumerMessage) return;
-		IntermixBase<PORTS>* module = reinterpret_cast<IntermixBase<PORTS>*>(exp->rightExpander.consumerMessage);
-		rightExpander.producerMessage = module;
-		rightExpander.messageFlipRequested = true;
-		
+		IntermixBase<PORTS>* module = this->master;
+		if (!module) return;
+		uint32_t id = module->expGetSnapshotId();
+		if (id == snapshotId && input == lastInput) return;
+		snapshotId = id;
+		lastInput = input;
+
 		// DSP
-		auto currentMatrix = module->expGetCurrentMatrix();
+		auto& currentMatrix = module->expGetSnapshot(id).currentMatrix;
 		for (int i = 0; i < PORTS; i++) {
 			float v = currentMatrix[input][i];
 			outputs[OUTPUT + i].setVoltage(v * 10.f);
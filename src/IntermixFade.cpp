@@ -12,7 +12,7 @@ enum class FADE {
 };
 
 template<int PORTS>
-struct IntermixFadeModule : Module {
+struct IntermixFadeModule : Module, IntermixExpander<PORTS> {
 	enum ParamIds {
 		ENUMS(PARAM_FADE, PORTS),
 		NUM_PARAMS
@@ -55,13 +55,18 @@ struct IntermixFadeModule : Module {
 		fade = FADE::INOUT;
 	}
 
+	void onExpanderChange(const ExpanderChangeEvent& e) override {
+		updateExpanderChain<PORTS>(this);
+	}
+
+	void onRemove() override {
+		expanderChainRemoved<PORTS>(this);
+	}
+
 	void process(const ProcessArgs& args) override {
 		// Expander
-		Module* exp = leftExpander.module;
-		if (!exp || (exp->model != modelIntermix && exp->model != modelIntermixGate && exp->model != modelIntermixEnv && exp->model != modelIntermixFade) || !exp->rightExpander.consumerMessage) return;
-		IntermixBase<PORTS>* module = reinterpret_cast<IntermixBase<PORTS>*>(exp->rightExpander.consumerMessage);
-		rightExpander.producerMessage = module;
-		rightExpander.messageFlipRequested = true;
+		IntermixBase<PORTS>* module = this->master;
+		if (!module) return;
 
 		// DSP
 		if (sceneDivider.process()) {
@@ -5,7 +5,7 @@ namespace StoermelderPackOne {
 namespace Intermix {
 
 template<int PORTS>
-struct IntermixGateModule : Module {
+struct IntermixGateModule : Module, IntermixExpander<PORTS> {
 	enum ParamIds {
 		NUM_PARAMS
 	};
@@ -23,6 +23,9 @@ struct IntermixGateModule : Module {
 	/** [Stored to JSON] */
 	int panelTheme = 0;
 
+	/** snapshotId of the last processed state */
+	uint32_t snapshotId = 0;
+
 	IntermixGateModule() {
 		panelTheme = pluginSettings.panelThemeDefault;
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -32,16 +35,24 @@ struct IntermixGateModule : Module {
 		onReset();
 	}
 
+	void onExpanderChange(const ExpanderChangeEvent& e) override {
+		updateExpanderChain<PORTS>(this);
+	}
+
+	void onRemove() override {
+		expanderChainRemoved<PORTS>(this);
+	}
+
 	void process(const ProcessArgs& args) override {
 		// Expander
-		Module* exp = leftExpander.module;
-		if (!exp || (exp->model != modelIntermix && exp->model != modelIntermixGate && exp->model != modelIntermixEnv && exp->model != modelIntermixFade) || !exp->rightExpander.consumerMessage) return;
-		IntermixBase<PORTS>* module = reinterpret_cast<IntermixBase<PORTS>*>(exp->rightExpander.consumerMessage);
-		rightExpander.producerMessage = module;
-		rightExpander.messageFlipRequested = true;
+		IntermixBase<PORTS>* module = this->master;
+		if (!module) return;
+		uint32_t id = module->expGetSnapshotId();
+		if (id == snapshotId) return;
+		snapshotId = id;
 
 		// DSP
-		auto currentMatrix = module->expGetCurrentMatrix();
+		auto& currentMatrix = module->expGetSnapshot(id).currentMatrix;
 		simd::float_4 out[PORTS / 4] = {};
 		for (int i = 0; i < PORTS; i++) {
 			for (int j = 0; j < PORTS; j += 4) {
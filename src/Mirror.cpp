@@ -1,11 +1,18 @@
 #include "plugin.hpp"
 #include "helpers/StripIdFixModule.hpp"
-#include "helpers/TaskProcessor.hpp"
+#include "helpers/CommandQueue.hpp"
 #include <plugin.hpp>
 
 namespace StoermelderPackOne {
 namespace Mirror {
 
+/** Tasks run on the UI-thread as the engine's mutex could already be locked, pushed as sticky commands run in this order */
+enum class UI_CMD {
+	CLEAN_HANDLES,
+	CREATE_HANDLES,
+	UNMAP_TARGETS
+};
+
 struct MirrorModule : Module, StripIdFixModule {
 	enum ParamIds {
 		NUM_PARAMS
@@ -54,7 +61,10 @@ struct MirrorModule : Module, StripIdFixModule {
 	dsp::ClockDivider processDivider;
 	dsp::ClockDivider handleDivider;
 
-	TaskProcessor<> taskProcessorUi;
+	CommandQueue<UI_CMD> uiCommands;
+	/** Parameters to be mapped by UI_CMD::CREATE_HANDLES */
+	std::vector<std::pair<int64_t, int>> uiSourceHandlesPending;
+	std::vector<std::pair<int64_t, int>> uiTargetHandlesPending;
 
 	MirrorModule() {
 		panelTheme = pluginSettings.panelThemeDefault;
@@ -86,24 +96,9 @@ struct MirrorModule : Module, StripIdFixModule {
 	void reset(bool stateOnly, bool createUiTask = false) {
 		if (!stateOnly) {
 			inChange = true;
-			auto cleanHandles = [=]() {
-				for (ParamHandle* sourceHandle : sourceHandles) {
-					APP->engine->removeParamHandle(sourceHandle);
-					delete sourceHandle;
-				}
-				for (ParamHandle* targetHandle : targetHandles) {
-					APP->engine->removeParamHandle(targetHandle);
-					delete targetHandle;
-				}
-
-				sourceHandles.clear();
-				targetHandles.clear();
-				inChange = false;
-			};
-
 			// Enqueue on the UI-thread as the engine's mutex could already be locked
 			if (createUiTask) {
-				taskProcessorUi.enqueue(cleanHandles);
+				uiCommands.pushSticky(UI_CMD::CLEAN_HANDLES);
 			}
 			else {
 				cleanHandles();
@@ -124,37 +119,96 @@ struct MirrorModule : Module, StripIdFixModule {
 		audioRate = false;
 	}
 
+	void cleanHandles() {
+		for (ParamHandle* sourceHandle : sourceHandles) {
+			APP->engine->removeParamHandle(sourceHandle);
+			delete sourceHandle;
+		}
+		for (ParamHandle* targetHandle : targetHandles) {
+			APP->engine->removeParamHandle(targetHandle);
+			delete targetHandle;
+		}
+
+		sourceHandles.clear();
+		targetHandles.clear();
+		inChange = false;
+	}
+
+	void createHandles() {
+		for (std::pair<int64_t, int>& p : uiSourceHandlesPending) {
+			ParamHandle* sourceHandle = new ParamHandle;
+			sourceHandle->text = "stoermelder MIRROR";
+			APP->engine->addParamHandle(sourceHandle);
+			APP->engine->updateParamHandle(sourceHandle, p.first, p.second, false);
+			sourceHandles.push_back(sourceHandle);
+		}
+		for (std::pair<int64_t, int>& p : uiTargetHandlesPending) {
+			ParamHandle* targetHandle = new ParamHandle;
+			targetHandle->text = "stoermelder MIRROR";
+			APP->engine->addParamHandle(targetHandle);
+			APP->engine->updateParamHandle(targetHandle, p.first, p.second, false);
+			targetHandles.push_back(targetHandle);
+		}
+		uiSourceHandlesPending.clear();
+		uiTargetHandlesPending.clear();
+		inChange = false;
+	}
+
+	void unmapTargets() {
+		if (inChange) return;
+		for (size_t i = 0; i < sourceHandles.size(); i++) {
+			if (sourceHandles[i]->moduleId >= 0) continue;
+			for (size_t j = i; j < targetHandles.size(); j += sourceHandles.size()) {
+				ParamHandle* targetHandle = targetHandles[j];
+				if (targetHandle->moduleId >= 0) {
+					APP->engine->updateParamHandle(targetHandle, -1, 0, true);
+				}
+			}
+		}
+	}
+
+	/** Runs the tasks enqueued for the UI-thread, called from the widget's step() */
+	void processUi() {
+		uiCommands.process([this](UI_CMD cmd) {
+			switch (cmd) {
+				case UI_CMD::CLEAN_HANDLES:
+					cleanHandles();
+					break;
+				case UI_CMD::CREATE_HANDLES:
+					createHandles();
+					break;
+				case UI_CMD::UNMAP_TARGETS:
+					unmapTargets();
+					break;
+			}
+		});
+	}
+
 	void process(const ProcessArgs& args) override {
 		if (inChange) return;
 
 		// Sync source paramId to target handles in case a parameter has been unmapped
 		if (handleDivider.process()) {
+			bool unmap = false;
 			for (size_t i = 0; i < sourceHandles.size(); i++) {
 				ParamHandle* sourceHandle = sourceHandles[i];
 				sourceHandle->color = mappingIndicatorHidden ? color::BLACK_TRANSPARENT : nvgRGB(0x40, 0xff, 0xff);
 
 				size_t j = i;
-				std::list<std::function<void()>> handleList;
 				while (j < targetHandles.size()) {
 					ParamHandle* targetHandle = targetHandles[j];
 					targetHandle->color = mappingIndicatorHidden ? color::BLACK_TRANSPARENT : nvgRGB(0xff, 0x40, 0xff);
 					if (sourceHandle->moduleId < 0 && targetHandle->moduleId >= 0) {
-						// Unmap target parameter
-						// This might cause a deadlock as the engine's mutex could already be locked
-						handleList.push_back([targetHandle]() {
-							APP->engine->updateParamHandle(targetHandle, -1, 0, true);
-						});
+						unmap = true;
 					}
-
 					j += sourceHandles.size();
 				}
+			}
 
-				// Enqueue on the UI-thread for cleaning up ParamHandles
-				if (handleList.size() > 0) {
-					taskProcessorUi.enqueue([handleList]() {
-						for (std::function<void()> f : handleList) f();
-					});
-				}
+			// Enqueue on the UI-thread for unmapping target parameters, as unmapping here might cause
+			// a deadlock. Targets still mapped are found again, so one pending command is sufficient.
+			if (unmap) {
+				uiCommands.pushSticky(UI_CMD::UNMAP_TARGETS);
 			}
 		}
 
@@ -334,7 +388,8 @@ struct MirrorModule : Module, StripIdFixModule {
 		}
 
 		inChange = true;
-		std::list<std::function<void()>> handleList;
+		uiSourceHandlesPending.clear();
+		uiTargetHandlesPending.clear();
 
 		json_t* sourceMapsJ = json_object_get(rootJ, "sourceMaps");
 		if (sourceMapsJ) {
@@ -347,14 +402,8 @@ struct MirrorModule : Module, StripIdFixModule {
 				int paramId = json_integer_value(paramIdJ);
 				moduleId = idFix(moduleId);
 
-				// This might cause a deadlock as the engine's mutex could already be locked
-				handleList.push_back([=]() {
-					ParamHandle* sourceHandle = new ParamHandle;
-					sourceHandle->text = "stoermelder MIRROR";
-					APP->engine->addParamHandle(sourceHandle);
-					APP->engine->updateParamHandle(sourceHandle, moduleId, paramId, false);
-					sourceHandles.push_back(sourceHandle);
-				});
+				// Creating the handle here might cause a deadlock as the engine's mutex could already be locked
+				uiSourceHandlesPending.push_back(std::make_pair(moduleId, paramId));
 			}
 		}
 
@@ -369,14 +418,8 @@ struct MirrorModule : Module, StripIdFixModule {
 				int paramId = json_integer_value(paramIdJ);
 				moduleId = idFix(moduleId);
 
-				// This might cause a deadlock as the engine's mutex could already be locked
-				handleList.push_back([=]() {
-					ParamHandle* targetHandle = new ParamHandle;
-					targetHandle->text = "stoermelder MIRROR";
-					APP->engine->addParamHandle(targetHandle);
-					APP->engine->updateParamHandle(targetHandle, moduleId, paramId, false);
-					targetHandles.push_back(targetHandle);
-				});
+				// Creating the handle here might cause a deadlock as the engine's mutex could already be locked
+				uiTargetHandlesPending.push_back(std::make_pair(moduleId, paramId));
 			}
 		}
 
@@ -406,10 +449,7 @@ struct MirrorModule : Module, StripIdFixModule {
 		idFixClearMap();
 
 		// Enqueue on the UI-thread for creating ParamHandles
-		taskProcessorUi.enqueue([=]() {
-			for (std::function<void()> f : handleList) f();
-			inChange = false;
-		});
+		uiCommands.pushSticky(UI_CMD::CREATE_HANDLES);
 	}
 };
 
@@ -430,7 +470,7 @@ struct MirrorWidget : ThemedModuleWidget<MirrorModule> {
 
 	void step() override {
 		ThemedModuleWidget<MirrorModule>::step();
-		if (module) module->taskProcessorUi.process();
+		if (module) module->processUi();
 	}
 
 	void appendContextMenu(Menu* menu) override {
@@ -2,6 +2,7 @@
 #include "MapModuleBase.hpp"
 #include "components/Knobs.hpp"
 #include <thread>
+#include <atomic>
 #include <random>
 
 namespace StoermelderPackOne {
@@ -57,12 +58,244 @@ enum PLAYMODE {
     PLAYMODE_SEQRANDOM = 4
 };
 
+enum INTERPOLATION {
+    INTERPOLATION_NONE = 0,
+    INTERPOLATION_LINEAR = 1,
+    INTERPOLATION_CUBIC = 2
+};
+
 const int REMOVE_PLAYDIR_FWD = 1;
 const int REMOVE_PLAYDIR_REV = -1;
 const int REMOVE_PLAYDIR_NONE = 0;
 
 
-struct ReMoveModule : MapModuleBase<1> {
+/** Storage for the recorded sequences. Each frame holds the values of all LANES, interleaved and
+ * sampled on the same clock. Values in the range 0..1 are quantized to 16 bit and kept in
+ * fixed-size blocks of frames, which are allocated and claimed by a sequence only when its
+ * recording grows. All sequences share the same pool of blocks.
+ */
+template < int LANES >
+struct ReMoveBuffer {
+    static const int BLOCK_SIZE = 1024;
+    static const int MAX_BLOCKS = REMOVE_MAX_DATA / BLOCK_SIZE;
+    static const int SPARE_BLOCKS = 4;
+
+    /** allocated blocks of BLOCK_SIZE frames, NULL if not used yet */
+    uint16_t* blocks[MAX_BLOCKS] = {};
+    /** written by the DSP thread while recording, read by the UI thread in allocateSpare() */
+    std::atomic<int> blocksAllocated{0};
+    /** allocated blocks not claimed by any sequence */
+    uint8_t freeBlocks[MAX_BLOCKS];
+    int freeCount = 0;
+    /** blocks claimed by a sequence, in order of the sequence */
+    uint8_t seqBlocks[REMOVE_MAX_SEQ][MAX_BLOCKS];
+    int seqBlockCount[REMOVE_MAX_SEQ] = {};
+    /** blocks allocated ahead by the UI thread while recording is armed, taken by the DSP thread */
+    std::atomic<uint16_t*> spareBlocks[SPARE_BLOCKS];
+
+    ReMoveBuffer() {
+        for (int i = 0; i < SPARE_BLOCKS; i++) {
+            spareBlocks[i] = NULL;
+        }
+    }
+
+    ~ReMoveBuffer() {
+        clear();
+        for (int i = 0; i < SPARE_BLOCKS; i++) {
+            delete[] spareBlocks[i].exchange(NULL);
+        }
+    }
+
+    /** Frees all memory, must not be called while the DSP thread is running */
+    void clear() {
+        for (int i = 0; i < blocksAllocated; i++) {
+            delete[] blocks[i];
+            blocks[i] = NULL;
+        }
+        blocksAllocated = 0;
+        freeCount = 0;
+        for (int i = 0; i < REMOVE_MAX_SEQ; i++) {
+            seqBlockCount[i] = 0;
+        }
+    }
+
+    /** Returns the blocks of sequence s to the pool without freeing memory */
+    void release(int s) {
+        for (int i = 0; i < seqBlockCount[s]; i++) {
+            freeBlocks[freeCount++] = seqBlocks[s][i];
+        }
+        seqBlockCount[s] = 0;
+    }
+
+    /** Returns the blocks of all sequences to the pool, the memory stays readable for the DSP thread */
+    void releaseAll() {
+        for (int i = 0; i < REMOVE_MAX_SEQ; i++) {
+            release(i);
+        }
+    }
+
+    /** Allocates the spare blocks used by reserveSpare(), to be called regularly from the UI thread
+     * while recording is armed */
+    void allocateSpare() {
+        int n = blocksAllocated.load();
+        for (int i = 0; i < SPARE_BLOCKS && n + i < MAX_BLOCKS; i++) {
+            if (!spareBlocks[i].load()) {
+                spareBlocks[i].store(new uint16_t[BLOCK_SIZE * LANES]);
+            }
+        }
+    }
+
+    /** Frees the spare blocks not taken by the DSP thread, to be called when recording has stopped */
+    void releaseSpare() {
+        for (int i = 0; i < SPARE_BLOCKS; i++) {
+            if (spareBlocks[i].load()) {
+                delete[] spareBlocks[i].exchange(NULL);
+            }
+        }
+    }
+
+    /** Returns true if no more blocks can be claimed */
+    inline bool exhausted() {
+        return freeCount == 0 && blocksAllocated >= MAX_BLOCKS;
+    }
+
+    inline int capacity(int s) {
+        return seqBlockCount[s] * BLOCK_SIZE;
+    }
+
+    /** Number of frames sequence s can hold at most */
+    inline int available(int s) {
+        return capacity(s) + (freeCount + MAX_BLOCKS - blocksAllocated) * BLOCK_SIZE;
+    }
+
+    /** Claims blocks until sequence s can hold length frames, returns false if the pool is exhausted.
+     * Allocates memory, use reserveSpare() on the DSP thread. */
+    inline bool reserve(int s, int length) {
+        while (capacity(s) < length) {
+            int b;
+            if (freeCount > 0) {
+                b = freeBlocks[--freeCount];
+            }
+            else if (blocksAllocated < MAX_BLOCKS) {
+                b = blocksAllocated++;
+                blocks[b] = new uint16_t[BLOCK_SIZE * LANES];
+            }
+            else {
+                return false;
+            }
+            seqBlocks[s][seqBlockCount[s]++] = b;
+        }
+        return true;
+    }
+
+    /** Same as reserve() but takes new blocks from the spare blocks only, returns false if none is left */
+    inline bool reserveSpare(int s, int length) {
+        while (capacity(s) < length) {
+            int b;
+            if (freeCount > 0) {
+                b = freeBlocks[--freeCount];
+            }
+            else {
+                uint16_t* block = NULL;
+                for (int i = 0; i < SPARE_BLOCKS && !block && blocksAllocated < MAX_BLOCKS; i++) {
+                    block = spareBlocks[i].exchange(NULL);
+                }
+                if (!block) return false;
+                b = blocksAllocated++;
+                blocks[b] = block;
+            }
+            seqBlocks[s][seqBlockCount[s]++] = b;
+        }
+        return true;
+    }
+
+    /** Returns the LANES values of frame i in sequence s */
+    inline uint16_t* frame(int s, int i) {
+        return blocks[seqBlocks[s][i / BLOCK_SIZE]] + (i % BLOCK_SIZE) * LANES;
+    }
+
+    inline float get(int s, int i, int lane = 0) {
+        return frame(s, i)[lane] * (1.f / 65535.f);
+    }
+
+    inline void set(int s, int i, int lane, float v) {
+        frame(s, i)[lane] = (uint16_t)std::round(clamp(v, 0.f, 1.f) * 65535.f);
+    }
+
+    /** Serializes the first length frames of sequence s: differences of consecutive values of
+     * each lane are zigzag-encoded as variable-length integers, mostly one byte per value, and
+     * stored as base64, zlib-compressed if compress is set.
+     */
+    std::string toBase64(int s, int length, bool compress) {
+        std::vector<uint8_t> data;
+        data.reserve(length * LANES * 2);
+        int last[LANES] = {};
+        for (int i = 0; i < length; i++) {
+            uint16_t* f = frame(s, i);
+            for (int lane = 0; lane < LANES; lane++) {
+                int v = f[lane];
+                int d = v - last[lane];
+                last[lane] = v;
+                uint32_t z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+                while (z >= 0x80) {
+                    data.push_back((z & 0x7f) | 0x80);
+                    z >>= 7;
+                }
+                data.push_back(z);
+            }
+        }
+        if (compress) data = string::compress(data);
+        return string::toBase64(data.data(), data.size());
+    }
+
+    /** Restores sequence s from the output of toBase64(), returns the number of complete frames read.
+     * Corrupt data results in an empty sequence. */
+    int fromBase64(int s, const std::string& str, int length, bool compressed) {
+        std::vector<uint8_t> data;
+        try {
+            data = string::fromBase64(str);
+            if (compressed) {
+                // Every value takes at most three bytes
+                std::vector<uint8_t> z = std::move(data);
+                size_t size = length * LANES * 3 + 1;
+                data.resize(size);
+                string::uncompress(z, data.data(), &size);
+                data.resize(size);
+            }
+        }
+        catch (std::exception& e) {
+            WARN("REMOVE: Corrupt sequence data has been dropped, %s", e.what());
+            return 0;
+        }
+        if (!reserve(s, length)) length = capacity(s);
+        int last[LANES] = {};
+        int k = 0;
+        size_t p = 0;
+        while (k < length * LANES && p < data.size()) {
+            uint32_t z = 0;
+            int shift = 0;
+            while (p < data.size()) {
+                uint8_t b = data[p++];
+                z |= (uint32_t)(b & 0x7f) << shift;
+                shift += 7;
+                if (!(b & 0x80)) break;
+            }
+            int d = (int)(z >> 1) ^ -(int)(z & 1);
+            int lane = k % LANES;
+            last[lane] = clamp(last[lane] + d, 0, 65535);
+            frame(s, k / LANES)[lane] = last[lane];
+            k++;
+        }
+        return k / LANES;
+    }
+};
+
+
+/** ReMove recording LANES parameters, all lanes share the sequences, the sample clock and the
+ * play position. The CV ports are polyphonic with one channel per lane.
+ */
+template < int LANES >
+struct ReMoveModule : MapModuleBase<LANES> {
     enum ParamIds {
         RUN_PARAM,
         RESET_PARAM,
@@ -100,16 +333,14 @@ struct ReMoveModule : MapModuleBase<1> {
     bool audioRate;
 
     /** [Stored to JSON] recorded data */
-    float *seqData;
-    /** stores the current position in data */
+    ReMoveBuffer<LANES> seqData;
+    /** stores the current position in the current sequence */
     int dataPtr = 0;
 
     /** [Stored to JSON] number of sequences */
     int seqCount = 4;
     /** [Stored to JSON] currently selected sequence */
     int seq = 0;
-    int seqLow;
-    int seqHigh;
     /** [Stored to JSON] length of the seqences */
     int seqLength[REMOVE_MAX_SEQ];
 
@@ -132,7 +363,9 @@ struct ReMoveModule : MapModuleBase<1> {
     /** [Stored to JSON] recording mode */
     RECMODE recMode = RECMODE_TOUCH;
     bool recTouched = false;
-    float recTouch;
+    /** engine frame when recording has been armed */
+    int64_t recArmFrame = 0;
+    float recTouch[LANES];
     /** [Stored to JSON] autoplay after record */
     bool recAutoplay;
 
@@ -142,11 +375,17 @@ struct ReMoveModule : MapModuleBase<1> {
     bool locked = false;
 
     float engineSampleTime;
+    int64_t engineFrame = 0;
     dsp::Timer sampleTimer;
 
     /** [Stored to JSON] mode for playback */
     PLAYMODE playMode = PLAYMODE_LOOP;
     int playDir = REMOVE_PLAYDIR_FWD;
+    /** [Stored to JSON] interpolation between recorded frames on playback and PHASE-input */
+    INTERPOLATION interpolation = INTERPOLATION_NONE;
+    /** the last two frames written on playback, needed for interpolation towards the next frame */
+    uint16_t playFrame[2][LANES];
+    bool playFrameValid = false;
 
     std::default_random_engine randGen{(uint16_t)std::chrono::system_clock::now().time_since_epoch().count()};
     std::uniform_int_distribution<int> randDist{0, REMOVE_MAX_SEQ - 1};
@@ -166,64 +405,69 @@ struct ReMoveModule : MapModuleBase<1> {
     dsp::BooleanTrigger recTrigger;
     dsp::PulseGenerator outCvPulse;
 
-    dsp::SlewLimiter slewLimiter;
+    dsp::SlewLimiter slewLimiter[LANES];
 
     dsp::ClockDivider processDivider;
 	dsp::ClockDivider lightDivider;
 
-    /** last touched parameter to avoid frequent dynamic casting */
-    Widget *lastParamWidget;
+    /** Mouse state published by the widget on the UI thread: a widget is dragged, the dragged widget
+     * is a mapped parameter and the engine frame when it has been touched */
+    std::atomic<bool> uiDragged{false};
+    std::atomic<bool> uiTouched{false};
+    std::atomic<int64_t> uiTouchFrame{-1};
 
     /** history-item when starting recording */
     history::ModuleChange *recChangeHistory = NULL;
 
     ReMoveModule() {
         panelTheme = pluginSettings.panelThemeDefault;
-        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS); 
-        configParam<TriggerParamQuantity>(SEQP_PARAM, 0.0f, 1.0f, 0.0f, "Previous sequence");
-        configParam<TriggerParamQuantity>(SEQN_PARAM, 0.0f, 1.0f, 0.0f, "Next sequence");
-        configParam<TriggerParamQuantity>(RUN_PARAM, 0.0f, 1.0f, 0.0f, "Run");
-        configParam<TriggerParamQuantity>(RESET_PARAM, 0.0f, 1.0f, 0.0f, "Reset");
-        configParam<TriggerParamQuantity>(REC_PARAM, 0.0f, 1.0f, 0.0f, "Record");
-        configParam(SLEW_PARAM, 0.0f, 0.975f, 0.0f, "Slew");
-
-        seqData = new float[REMOVE_MAX_DATA];
+        this->config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS); 
+        this->template configParam<TriggerParamQuantity>(SEQP_PARAM, 0.0f, 1.0f, 0.0f, "Previous sequence");
+        this->template configParam<TriggerParamQuantity>(SEQN_PARAM, 0.0f, 1.0f, 0.0f, "Next sequence");
+        this->template configParam<TriggerParamQuantity>(RUN_PARAM, 0.0f, 1.0f, 0.0f, "Run");
+        this->template configParam<TriggerParamQuantity>(RESET_PARAM, 0.0f, 1.0f, 0.0f, "Reset");
+        this->template configParam<TriggerParamQuantity>(REC_PARAM, 0.0f, 1.0f, 0.0f, "Record");
+        this->configParam(SLEW_PARAM, 0.0f, 0.975f, 0.0f, "Slew");
+
         this->mappingIndicatorColor = nvgRGB(0x40, 0xff, 0xff);
-        paramHandles[0].text = "ReMove Lite";
+        for (int i = 0; i < LANES; i++) {
+            this->paramHandles[i].text = LANES == 1 ? "ReMove Lite" : string::f("ReMove lane %d", i + 1);
+        }
 
         processDivider.setDivision(64);
         lightDivider.setDivision(1024);
         onReset();
     }
 
-    ~ReMoveModule() {
-        delete[] seqData;
-    }
-
     void onReset() override {
-        MapModuleBase::onReset();
+        MapModuleBase<LANES>::onReset();
         audioRate = !settings::isPlugin;
         isPlaying = false;
         playDir = REMOVE_PLAYDIR_FWD;
         isRecording = false;
         recTouched = false;
         recAutoplay = false;
+        interpolation = INTERPOLATION_NONE;
         dataPtr = 0;
         sampleTimer.reset();
         seq = 0;
         seqResize(4);
-        valueFilters[0].reset();
+        for (int i = 0; i < LANES; i++) {
+            this->valueFilters[i].reset();
+        }
     }
 
-    void process(const ProcessArgs &args) override {
+    void process(const Module::ProcessArgs &args) override {
         engineSampleTime = args.sampleTime;
-        outputs[REC_OUTPUT].setVoltage(0);
+        engineFrame = args.frame;
+        this->outputs[REC_OUTPUT].setVoltage(0);
+        if (LANES > 1) this->outputs[CV_OUTPUT].setChannels(LANES);
 
         // Toggle record when button is pressed
-        if (recTrigger.process(params[REC_PARAM].getValue() + inputs[REC_INPUT].getVoltage())) {
+        if (recTrigger.process(this->params[REC_PARAM].getValue() + this->inputs[REC_INPUT].getVoltage())) {
             isPlaying = false;
-            ParamQuantity *paramQuantity = getParamQuantity(0);
-            if (paramQuantity != NULL) {
+            ParamQuantity* paramQuantity[LANES];
+            if (getParamQuantities(paramQuantity)) {
                 isRecording ^= true;
                 if (isRecording) {
                     startRecording();
@@ -237,22 +481,16 @@ struct ReMoveModule : MapModuleBase<1> {
 
         if (isRecording) {
             bool doRecord = true;
+            if (settings::headless) {
+                // No UI-thread is running, so there is no other place to allocate
+                seqData.allocateSpare();
+            }
 
             if (recMode == RECMODE_TOUCH && !recTouched) {
-                // check if mouse has been pressed on parameter
-                Widget *w = APP->event->getDraggedWidget();
-                if (w != NULL && w != lastParamWidget) {
-                    lastParamWidget = w;
-                    // it is not a good idea to do dynamic casting in the DSP thread,
-                    // so do this only once for each touched widget
-                    ParamWidget *pw = dynamic_cast<ParamWidget*>(w);
-                    if (pw != NULL && pw->getParamQuantity() == getParamQuantity(0)) {
-                        recTouched = true;
-                        recOutCvPulse.trigger();
-                    }
-                    else {
-                        doRecord = false;
-                    }
+                // check if mouse has been pressed on parameter since recording has been armed
+                if (uiTouched && uiTouchFrame >= recArmFrame) {
+                    recTouched = true;
+                    recOutCvPulse.trigger();
                 }
                 else {
                     doRecord = false;
@@ -260,9 +498,11 @@ struct ReMoveModule : MapModuleBase<1> {
             }
 
             if (recMode == RECMODE_MOVE && !recTouched) {
-                // check if param value has changed
-                if (getValue() != recTouch) {
-                    recTouched = true;
+                // check if any param value has changed
+                for (int i = 0; i < LANES; i++) {
+                    if (getValue(i) != recTouch[i]) recTouched = true;
+                }
+                if (recTouched) {
                     recOutCvPulse.trigger();
                 }
                 else {
@@ -273,38 +513,45 @@ struct ReMoveModule : MapModuleBase<1> {
             if (doRecord) {
                 if (sampleTimer.process(args.sampleTime) > sampleRate) {
                     // check if mouse button has been released
-                    if (APP->event->getDraggedWidget() == NULL) {
+                    if (!uiDragged) {
                         if (recMode == RECMODE_TOUCH) {
                             stopRecording();
                         }
                         if (recMode == RECMODE_MOVE) {
                             stopRecording();
-                            // trim unchanged values from the end
-                            int i = seqLow + seqLength[seq] - 1;
-                            if (i > seqLow) {
-                                float l = seqData[i];
-                                while (i > seqLow && l == seqData[i - 1]) i--;
-                                seqLength[seq] = i - seqLow;
+                            // trim unchanged frames from the end
+                            int i = seqLength[seq] - 1;
+                            if (i > 0) {
+                                uint16_t* l = seqData.frame(seq, i);
+                                while (i > 0 && std::equal(l, l + LANES, seqData.frame(seq, i - 1))) i--;
+                                seqLength[seq] = i;
                             }
                         } 
                     }
                     
                     // Are we still recording?
-                    if (isRecording) {
-                        seqData[dataPtr] = getValue();
+                    // Claim more memory if needed, stop recording when the buffer is full.
+                    // Spare blocks are allocated only after recording has been armed, until
+                    // the UI thread has caught up the frame is skipped.
+                    bool reserved = isRecording && seqData.reserveSpare(seq, dataPtr + 2);
+                    if (isRecording && !reserved && seqData.exhausted()) {
+                        stopRecording();
+                    }
 
-                        // Push value on parameter only when CV input is been used
-                        ParamQuantity* paramQuantity = NULL;
-                        if (inputs[CV_INPUT].isConnected()) paramQuantity = getParamQuantity(0);
-                        setValue(seqData[dataPtr], paramQuantity);
+                    if (reserved) {
+                        // Push values on parameters only when CV input is been used
+                        ParamQuantity* paramQuantity[LANES] = {};
+                        bool push = this->inputs[CV_INPUT].isConnected();
+                        for (int i = 0; i < LANES; i++) {
+                            seqData.set(seq, dataPtr, i, getValue(i));
+                            if (push) paramQuantity[i] = this->getParamQuantity(i);
+                        }
+                        setFrame(seqData.frame(seq, dataPtr), paramQuantity, sampleRate);
                         seqLength[seq]++;
                         dataPtr++;
-                        // Stop recording when end of sequence is reached
-                        if (dataPtr == seqHigh) {
-                            stopRecording();
-                        }
                         if (recMode == RECMODE_SAMPLEHOLD) {
-                            seqData[dataPtr] = seqData[dataPtr - 1];
+                            uint16_t* l = seqData.frame(seq, dataPtr - 1);
+                            std::copy(l, l + LANES, seqData.frame(seq, dataPtr));
                             seqLength[seq]++;
                             stopRecording();
                         }
@@ -314,93 +561,112 @@ struct ReMoveModule : MapModuleBase<1> {
                 }
 
                 if (recOutCvMode == RECOUTCVMODE_GATE)
-                    outputs[REC_OUTPUT].setVoltage(10);
+                    this->outputs[REC_OUTPUT].setVoltage(10);
             }
         }
         else {
             // Move to previous sequence on button-press
-            if (seqPTrigger.process(params[SEQP_PARAM].getValue())) {
+            if (seqPTrigger.process(this->params[SEQP_PARAM].getValue())) {
                 seqPrev();
             }
 
             // Move to next sequence on button-press
-            if (seqNTrigger.process(params[SEQN_PARAM].getValue())) {
+            if (seqNTrigger.process(this->params[SEQN_PARAM].getValue())) {
                 seqNext();
             }
 
             // RESET-input: reset ptr when button is pressed or input is triggered
-            if (resetCvTrigger.process(params[RESET_PARAM].getValue() + inputs[RESET_INPUT].getVoltage())) {
-                dataPtr = seqLow;
+            if (resetCvTrigger.process(this->params[RESET_PARAM].getValue() + this->inputs[RESET_INPUT].getVoltage())) {
+                dataPtr = 0;
                 playDir = REMOVE_PLAYDIR_FWD;
                 sampleTimer.reset();
-                valueFilters[0].reset();
+                for (int i = 0; i < LANES; i++) {
+                    this->valueFilters[i].reset();
+                }
                 resetCvTimer.reset();
             }
 
             // SEQ#-input
-            if (resetCvTimer.process(args.sampleTime) >= 1e-3f && inputs[SEQ_INPUT].isConnected()) {
+            if (resetCvTimer.process(args.sampleTime) >= 1e-3f && this->inputs[SEQ_INPUT].isConnected()) {
                 switch (seqCvMode) {
                     case SEQCVMODE_10V:
-                        seqSet(floor(rescale(inputs[SEQ_INPUT].getVoltage(), 0.f, 10.f, 0, seqCount)));
+                        seqSet(floor(rescale(this->inputs[SEQ_INPUT].getVoltage(), 0.f, 10.f, 0, seqCount)));
                         break;
                     case SEQCVMODE_C4:
-                        seqSet(round(clamp(inputs[SEQ_INPUT].getVoltage() * 12.f, 0.f, REMOVE_MAX_SEQ - 1.f)));
+                        seqSet(round(clamp(this->inputs[SEQ_INPUT].getVoltage() * 12.f, 0.f, REMOVE_MAX_SEQ - 1.f)));
                         break;
                     case SEQCVMODE_TRIG:
-                        if (seqCvTrigger.process(inputs[SEQ_INPUT].getVoltage()))
+                        if (seqCvTrigger.process(this->inputs[SEQ_INPUT].getVoltage()))
                             seqNext();
                         break;
                 }
             }
 
             // RUN-button: toggle playing when button is pressed
-            if (runTrigger.process(params[RUN_PARAM].getValue())) {
+            if (runTrigger.process(this->params[RUN_PARAM].getValue())) {
                 isPlaying ^= true;
                 sampleTimer.reset();
             }
 
             // RUN-input
-            if (inputs[RUN_INPUT].isConnected()) {
+            if (this->inputs[RUN_INPUT].isConnected()) {
                 switch (runCvMode) {
                     case RUNCVMODE_GATE:
-                        isPlaying = (inputs[RUN_INPUT].getVoltage() >= 1.f);
+                        isPlaying = (this->inputs[RUN_INPUT].getVoltage() >= 1.f);
                         break;
                     case RUNCVMODE_TRIG:
-                        if (runCvTrigger.process(inputs[RUN_INPUT].getVoltage()))
+                        if (runCvTrigger.process(this->inputs[RUN_INPUT].getVoltage()))
                             isPlaying = !isPlaying;
                         break;
                 }
             }
 
             // PHASE-input: if position-input is connected set the position directly, ignore playing
-            if (inputs[PHASE_INPUT].isConnected()) {
+            if (this->inputs[PHASE_INPUT].isConnected()) {
                 isPlaying = false;
+                playFrameValid = false;
                 if (audioRate || processDivider.process()) {
-                    ParamQuantity *paramQuantity = getParamQuantity(0);
-                    if (paramQuantity != NULL) {
-                        float v = clamp(inputs[PHASE_INPUT].getVoltage(), 0.f, 10.f);
-                        dataPtr = floor(rescale(v, 0.f, 10.f, seqLow, seqLow + seqLength[seq] - 1));
-                        v = seqData[dataPtr];
-                        setValue(v, paramQuantity);
+                    ParamQuantity* paramQuantity[LANES];
+                    if (getParamQuantities(paramQuantity) && seqLength[seq] > 0) {
+                        float v = clamp(this->inputs[PHASE_INPUT].getVoltage(), 0.f, 10.f);
+                        float pos = rescale(v, 0.f, 10.f, 0, seqLength[seq] - 1);
+                        dataPtr = floor(pos);
+                        if (interpolation == INTERPOLATION_NONE) {
+                            setFrame(seqData.frame(seq, dataPtr), paramQuantity, sampleRate);
+                        }
+                        else {
+                            int l = seqLength[seq] - 1;
+                            setFrame(
+                                seqData.frame(seq, std::max(dataPtr - 1, 0)),
+                                seqData.frame(seq, dataPtr),
+                                seqData.frame(seq, std::min(dataPtr + 1, l)),
+                                seqData.frame(seq, std::min(dataPtr + 2, l)),
+                                pos - dataPtr, paramQuantity, getProcessTime(args.sampleTime));
+                        }
                     }
                 }
             }
 
             if (isPlaying) {
                 if (sampleTimer.process(args.sampleTime) > sampleRate) {
-                    ParamQuantity* paramQuantity = getParamQuantity(0);
-                    if (paramQuantity == NULL)
+                    ParamQuantity* paramQuantity[LANES];
+                    if (!getParamQuantities(paramQuantity))
                         isPlaying = false;
 
                     // are we still playing?
                     if (isPlaying && seqLength[seq] > 0) {
-                        float v = seqData[dataPtr];
+                        uint16_t* f = seqData.frame(seq, dataPtr);
                         dataPtr = dataPtr + playDir;
-                        setValue(v, paramQuantity);
-                        if (dataPtr == seqLow + seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
+                        setFrame(f, paramQuantity, interpolation == INTERPOLATION_NONE ? sampleRate : getProcessTime(args.sampleTime));
+                        // Keep copies of the written frames as the sequence might change below
+                        if (!playFrameValid) std::copy(f, f + LANES, playFrame[1]);
+                        std::copy(playFrame[1], playFrame[1] + LANES, playFrame[0]);
+                        std::copy(f, f + LANES, playFrame[1]);
+                        playFrameValid = true;
+                        if (dataPtr == seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
                             switch (playMode) {
                                 case PLAYMODE_LOOP: 
-                                    dataPtr = seqLow; break;
+                                    dataPtr = 0; break;
                                 case PLAYMODE_ONESHOT:      // stay on last value
                                     dataPtr--; playDir = REMOVE_PLAYDIR_NONE; break;
                                 case PLAYMODE_PINGPONG:     // reverse direction
@@ -411,94 +677,162 @@ struct ReMoveModule : MapModuleBase<1> {
                                     seqRand(); break;
                             }
                         }
-                        if (dataPtr == seqLow - 1) {
+                        if (dataPtr == -1) {
                             dataPtr++; playDir = REMOVE_PLAYDIR_FWD;
                         }
                     }
                     sampleTimer.reset();
                 }
+                else if (interpolation != INTERPOLATION_NONE && playFrameValid && seqLength[seq] > 0 && (audioRate || processDivider.process())) {
+                    // Move towards the next frame between the samples of the recording
+                    ParamQuantity* paramQuantity[LANES];
+                    getParamQuantities(paramQuantity);
+                    int l = seqLength[seq] - 1;
+                    int i = clamp(dataPtr, 0, l);
+                    float t = std::min(sampleTimer.time / sampleRate, 1.f);
+                    setFrame(playFrame[0], playFrame[1], seqData.frame(seq, i), seqData.frame(seq, clamp(i + playDir, 0, l)),
+                        t, paramQuantity, getProcessTime(args.sampleTime));
+                }
                 processSetValue();
             }
             else {
                 // Not playing and not recording -> bypass input to output for empty sequences
-                if (seqLength[seq] == 0)
-                    setValue(getValue());
+                if (seqLength[seq] == 0) {
+                    for (int i = 0; i < LANES; i++) {
+                        setValue(i, getValue(i), sampleRate);
+                    }
+                }
             }
         }
 
         // REC-out in trigger mode
         if (recOutCvMode == RECOUTCVMODE_TRIG)
-            outputs[REC_OUTPUT].setVoltage(recOutCvPulse.process(args.sampleTime) ? 10.f : 0.f);
+            this->outputs[REC_OUTPUT].setVoltage(recOutCvPulse.process(args.sampleTime) ? 10.f : 0.f);
 
         // Set channel lights infrequently
         if (lightDivider.process()) {
-            if (inputs[PHASE_INPUT].isConnected()) {
-                lights[RUN_LIGHT + 0].setBrightness(0.f);
-                lights[RUN_LIGHT + 1].setBrightness(1.f);
-                lights[RESET_LIGHT + 0].setBrightness(0.f);
-                lights[RESET_LIGHT + 1].setBrightness(1.f);
+            if (this->inputs[PHASE_INPUT].isConnected()) {
+                this->lights[RUN_LIGHT + 0].setBrightness(0.f);
+                this->lights[RUN_LIGHT + 1].setBrightness(1.f);
+                this->lights[RESET_LIGHT + 0].setBrightness(0.f);
+                this->lights[RESET_LIGHT + 1].setBrightness(1.f);
             }
             else {
-                lights[RUN_LIGHT + 0].setBrightness(isPlaying);
-                lights[RUN_LIGHT + 1].setBrightness(0.f);
-                lights[RESET_LIGHT + 0].setSmoothBrightness(resetCvTrigger.isHigh(), lightDivider.getDivision() * args.sampleTime);
-                lights[RESET_LIGHT + 1].setBrightness(0.f);
+                this->lights[RUN_LIGHT + 0].setBrightness(isPlaying);
+                this->lights[RUN_LIGHT + 1].setBrightness(0.f);
+                this->lights[RESET_LIGHT + 0].setSmoothBrightness(resetCvTrigger.isHigh(), lightDivider.getDivision() * args.sampleTime);
+                this->lights[RESET_LIGHT + 1].setBrightness(0.f);
             }
 
-            lights[REC_LIGHT].setBrightness(isRecording);
+            this->lights[REC_LIGHT].setBrightness(isRecording);
 
             for (int i = 0; i < 8; i++) {
-                lights[SEQ_LIGHT + i].setBrightness((seq == i ? 0.7f : 0) + (seqCount >= i + 1 ? 0.3f : 0));
+                this->lights[SEQ_LIGHT + i].setBrightness((seq == i ? 0.7f : 0) + (seqCount >= i + 1 ? 0.3f : 0));
             }
         }
 
-        MapModuleBase::process(args);
+        MapModuleBase<LANES>::process(args);
+    }
+
+    /** Fetches the mapped parameter of every lane, returns false if no lane is mapped */
+    inline bool getParamQuantities(ParamQuantity** paramQuantity) {
+        bool mapped = false;
+        for (int i = 0; i < LANES; i++) {
+            paramQuantity[i] = this->getParamQuantity(i);
+            mapped |= paramQuantity[i] != NULL;
+        }
+        return mapped;
+    }
+
+    inline bool isLaneParamQuantity(ParamQuantity* paramQuantity) {
+        if (paramQuantity == NULL) return false;
+        for (int i = 0; i < LANES; i++) {
+            if (paramQuantity == this->getParamQuantity(i)) return true;
+        }
+        return false;
     }
 
-    inline float getValue() {
+    inline float getValue(int lane) {
         float v = 0.f;
-        if (inputs[CV_INPUT].isConnected()) {
+        if (this->inputs[CV_INPUT].isConnected()) {
             switch (inCvMode) {
                 case INCVMODE_UNI:
-                    v = rescale(clamp(inputs[CV_INPUT].getVoltage(), 0.f, 10.f), 0.f, 10.f, 0.f, 1.f);
+                    v = rescale(clamp(this->inputs[CV_INPUT].getPolyVoltage(lane), 0.f, 10.f), 0.f, 10.f, 0.f, 1.f);
                     break;
                 case INCVMODE_BI:
-                    v = rescale(clamp(inputs[CV_INPUT].getVoltage(), -5.f, 5.f), -5.f, 5.f, 0.f, 1.f);
+                    v = rescale(clamp(this->inputs[CV_INPUT].getPolyVoltage(lane), -5.f, 5.f), -5.f, 5.f, 0.f, 1.f);
                     break;
             }
         }
         else {
-            ParamQuantity *paramQuantity = getParamQuantity(0);
+            ParamQuantity *paramQuantity = this->getParamQuantity(lane);
             if (paramQuantity) {
                 v = paramQuantity->getScaledValue();
-                v = valueFilters[0].process(engineSampleTime, v);
+                v = this->valueFilters[lane].process(engineSampleTime, v);
             }
         }
         return v;
     }
 
-    inline void setValue(float v, ParamQuantity* paramQuantity = NULL) {
-        //v = valueFilters[0].process(sampleTime, v);
-        if (params[SLEW_PARAM].getValue() > 0.f) {
-            float s = 100.f * (1.f - params[SLEW_PARAM].getValue());
-            slewLimiter.setRiseFall(s, s);
-            v = slewLimiter.process(sampleRate, v);
+    /** Time between two calls of the interpolation on playback and PHASE-input */
+    inline float getProcessTime(float sampleTime) {
+        return audioRate ? sampleTime : sampleTime * processDivider.getDivision();
+    }
+
+    /** Writes the values of a recorded frame to all lanes in one pass */
+    inline void setFrame(const uint16_t* f, ParamQuantity** paramQuantity, float dt) {
+        for (int i = 0; i < LANES; i++) {
+            setValue(i, f[i] * (1.f / 65535.f), dt, paramQuantity[i]);
+        }
+    }
+
+    /** Writes the values between frames f1 (t = 0) and f2 (t = 1) to all lanes in one pass,
+     * f0 and f3 are the surrounding frames used by cubic interpolation.
+     */
+    inline void setFrame(const uint16_t* f0, const uint16_t* f1, const uint16_t* f2, const uint16_t* f3, float t, ParamQuantity** paramQuantity, float dt) {
+        for (int i = 0; i < LANES; i++) {
+            float p1 = f1[i] * (1.f / 65535.f);
+            float p2 = f2[i] * (1.f / 65535.f);
+            float v;
+            if (interpolation == INTERPOLATION_CUBIC) {
+                // Catmull-Rom spline
+                float p0 = f0[i] * (1.f / 65535.f);
+                float p3 = f3[i] * (1.f / 65535.f);
+                v = p1 + 0.5f * t * (p2 - p0 + t * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3 + t * (3.f * (p1 - p2) + p3 - p0)));
+                v = clamp(v, 0.f, 1.f);
+            }
+            else {
+                v = p1 + t * (p2 - p1);
+            }
+            setValue(i, v, dt, paramQuantity[i]);
+        }
+    }
+
+    inline void setValue(int lane, float v, float dt, ParamQuantity* paramQuantity = NULL) {
+        //v = valueFilters[lane].process(sampleTime, v);
+        if (this->params[SLEW_PARAM].getValue() > 0.f) {
+            float s = 100.f * (1.f - this->params[SLEW_PARAM].getValue());
+            slewLimiter[lane].setRiseFall(s, s);
+            v = slewLimiter[lane].process(dt, v);
         }
 
         if (paramQuantity) {
             //paramQuantity->setScaledValue(v);
             float vScaled = math::rescale(v, 0.f, 1.f, paramQuantity->getMinValue(), paramQuantity->getMaxValue());
+            // Recorded values are quantized, snap them back to integers where applicable
+            if (paramQuantity->snapEnabled) vScaled = std::round(vScaled);
             paramQuantity->getParam()->setValue(vScaled);
         }
         switch (outCvMode) {
             case OUTCVMODE_CV_UNI:
-                outputs[CV_OUTPUT].setVoltage(rescale(v, 0.f, 1.f, 0.f, 10.f));
+                this->outputs[CV_OUTPUT].setVoltage(rescale(v, 0.f, 1.f, 0.f, 10.f), lane);
                 break;
             case OUTCVMODE_CV_BI:
-                outputs[CV_OUTPUT].setVoltage(rescale(v, 0.f, 1.f, -5.f, 5.f));
+                this->outputs[CV_OUTPUT].setVoltage(rescale(v, 0.f, 1.f, -5.f, 5.f), lane);
                 break;
             case OUTCVMODE_EOC:
-                if (dataPtr == seqLow + seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
+                if (lane > 0) break;
+                if (dataPtr == seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
                     switch (playMode) {
                         case PLAYMODE_LOOP:
                         case PLAYMODE_ONESHOT:
@@ -510,7 +844,7 @@ struct ReMoveModule : MapModuleBase<1> {
                             break;
                     }
                 }
-                if (dataPtr == seqLow - 1) {
+                if (dataPtr == -1) {
                     outCvPulse.trigger();
                 }
                 break;
@@ -519,7 +853,7 @@ struct ReMoveModule : MapModuleBase<1> {
 
     inline void processSetValue() {
         if (outCvMode == OUTCVMODE_EOC) {
-            outputs[CV_OUTPUT].setVoltage(outCvPulse.process(engineSampleTime));
+            this->outputs[CV_OUTPUT].setVoltage(outCvPulse.process(engineSampleTime));
         }
     }
 
@@ -528,26 +862,33 @@ struct ReMoveModule : MapModuleBase<1> {
         recChangeHistory = new history::ModuleChange;
         recChangeHistory->name = "ReMOVE recording";
         recChangeHistory->moduleId = this->id;
-        recChangeHistory->oldModuleJ = toJson();
+        recChangeHistory->oldModuleJ = this->toJson();
 
         seqLength[seq] = 0;
-        dataPtr = seqLow;
+        seqData.release(seq);
+        dataPtr = 0;
+        playFrameValid = false;
         sampleTimer.reset();
-        if (!inputs[CV_INPUT].isConnected()) paramHandles[0].color = nvgRGB(0xff, 0x40, 0xff);
-        recTouch = getValue();
+        for (int i = 0; i < LANES; i++) {
+            if (!this->inputs[CV_INPUT].isConnected()) this->paramHandles[i].color = nvgRGB(0xff, 0x40, 0xff);
+            recTouch[i] = getValue(i);
+        }
         recTouched = false;
+        recArmFrame = engineFrame;
     }
 
     void stopRecording() {
         isRecording = false;
-        if (dataPtr != seqLow) recOutCvPulse.trigger();
-        dataPtr = seqLow;
+        if (dataPtr != 0) recOutCvPulse.trigger();
+        dataPtr = 0;
         sampleTimer.reset();
-        paramHandles[0].color = nvgRGB(0x40, 0xff, 0xff);
-        valueFilters[0].reset();
+        for (int i = 0; i < LANES; i++) {
+            this->paramHandles[i].color = nvgRGB(0x40, 0xff, 0xff);
+            this->valueFilters[i].reset();
+        }
 
         if (recChangeHistory) {
-            recChangeHistory->newModuleJ = toJson();
+            recChangeHistory->newModuleJ = this->toJson();
             APP->history->push(recChangeHistory);
             recChangeHistory = NULL;
         }
@@ -591,69 +932,53 @@ struct ReMoveModule : MapModuleBase<1> {
         seq = 0;
         seqCount = c;
         dataPtr = 0;
+        playFrameValid = false;
         for (int i = 0; i < REMOVE_MAX_SEQ; i++) seqLength[i] = 0;
+        // Called from the UI thread, the DSP thread might still read the blocks
+        seqData.releaseAll();
         seqUpdate();
     }
 
     inline void seqUpdate() {
-        int s = REMOVE_MAX_DATA / seqCount;
-        seqLow = seq * s;
-        seqHigh =  (seq + 1) * s;
         switch (seqChangeMode) {
             case SEQCHANGEMODE_RESTART:
-                dataPtr = seqLow;
+                dataPtr = 0;
                 playDir = REMOVE_PLAYDIR_FWD;
                 sampleTimer.reset();
-                valueFilters[0].reset();
+                for (int i = 0; i < LANES; i++) {
+                    this->valueFilters[i].reset();
+                }
                 break;
             case SEQCHANGEMODE_OFFSET:
-                dataPtr = seqLength[seq] > 0 ? seqLow + (dataPtr % s) % seqLength[seq] : seqLow;
+                dataPtr = seqLength[seq] > 0 ? dataPtr % seqLength[seq] : 0;
                 break;
         }
     }
 
 
     void clearMap(int id) override {
-        onReset();
-        MapModuleBase::clearMap(id);
+        // A single lane is useless without its parameter, other lanes keep their recordings
+        if (LANES == 1) onReset();
+        MapModuleBase<LANES>::clearMap(id);
     }
 
     void enableLearn(int id) override {
         if (isRecording) return;
-        MapModuleBase::enableLearn(id);
+        MapModuleBase<LANES>::enableLearn(id);
     }
 
     json_t *dataToJson() override {
-        json_t *rootJ = MapModuleBase::dataToJson();
+        json_t *rootJ = MapModuleBase<LANES>::dataToJson();
         json_object_set_new(rootJ, "panelTheme", json_integer(panelTheme));
         json_object_set_new(rootJ, "audioRate", json_boolean(audioRate));
 
         json_t *rec0J = json_object();
 
-        int s = REMOVE_MAX_DATA / seqCount;
         json_t *seqDataJ = json_array();
         for (int i = 0; i < seqCount; i++) {
-            json_t *seqData1J = json_array();
-            float last1 = 100.f, last2 = -100.f;
-            for (int j = 0; j < seqLength[i]; j++) {
-                if (last1 == last2) {
-                    // 2 times same value -> compress!
-                    int c = 0;
-                    while (seqData[i * s + j] == last1 && j < seqLength[i]) { c++; j++; }
-                    json_array_append_new(seqData1J, json_integer(c));
-                    if (j < seqLength[i]) json_array_append_new(seqData1J, json_real(seqData[i * s + j]));
-                    last2 = -100.f;
-                    last1 = seqData[i * s + j];
-                } 
-                else {
-                    json_array_append_new(seqData1J, json_real(seqData[i * s + j]));
-                    last2 = last1;
-                    last1 = seqData[i * s + j];
-                }
-            }
-            json_array_append_new(seqDataJ, seqData1J);
+            json_array_append_new(seqDataJ, json_string(seqData.toBase64(i, seqLength[i], true).c_str()));
         }
-        json_object_set_new(rec0J, "seqData", seqDataJ);
+        json_object_set_new(rec0J, "seqDataZ", seqDataJ);
 
         json_t *seqLengthJ = json_array();
         for (int i = 0; i < seqCount; i++) {
@@ -672,6 +997,7 @@ struct ReMoveModule : MapModuleBase<1> {
         json_object_set_new(rec0J, "recMode", json_integer(recMode));
         json_object_set_new(rec0J, "recAutoplay", json_boolean(recAutoplay));
         json_object_set_new(rec0J, "playMode", json_integer(playMode));
+        json_object_set_new(rec0J, "interpolation", json_integer(interpolation));
         json_object_set_new(rec0J, "sampleRate", json_real(sampleRate));
         json_object_set_new(rec0J, "isPlaying", json_boolean(isPlaying));
 
@@ -683,7 +1009,7 @@ struct ReMoveModule : MapModuleBase<1> {
     }
 
     void dataFromJson(json_t *rootJ) override {
-        MapModuleBase::dataFromJson(rootJ);
+        MapModuleBase<LANES>::dataFromJson(rootJ);
         panelTheme = json_integer_value(json_object_get(rootJ, "panelTheme"));
         json_t* audioRateJ = json_object_get(rootJ, "audioRate");
         if (audioRateJ) audioRate = json_boolean_value(audioRateJ);
@@ -713,6 +1039,8 @@ struct ReMoveModule : MapModuleBase<1> {
         if (recAutoplayJ) recAutoplay = json_boolean_value(recAutoplayJ);
         json_t *playModeJ = json_object_get(rec0J, "playMode");
         if (playModeJ) playMode = (PLAYMODE)json_integer_value(playModeJ);
+        json_t *interpolationJ = json_object_get(rec0J, "interpolation");
+        if (interpolationJ) interpolation = (INTERPOLATION)json_integer_value(interpolationJ);
         json_t *sampleRateJ = json_object_get(rec0J, "sampleRate");
         if (sampleRateJ) sampleRate = json_real_value(sampleRateJ);
         json_t *isPlayingJ = json_object_get(rec0J, "isPlaying");
@@ -728,13 +1056,27 @@ struct ReMoveModule : MapModuleBase<1> {
             }
         }
 
-        int s = REMOVE_MAX_DATA / seqCount;
+        seqData.clear();
+        // "seqDataBin" holds the same data uncompressed
+        json_t *seqDataZJ = json_object_get(rec0J, "seqDataZ");
+        json_t *seqDataBinJ = seqDataZJ ? seqDataZJ : json_object_get(rec0J, "seqDataBin");
         json_t *seqDataJ = json_object_get(rec0J, "seqData");
-        if (seqDataJ) {
+        if (seqDataBinJ) {
+            json_t *d;
+            size_t i;
+            json_array_foreach(seqDataBinJ, i, d) {
+                const char* str = json_string_value(d);
+                if ((int)i >= seqCount || !str) continue;
+                seqLength[i] = seqData.fromBase64(i, str, seqLength[i], seqDataZJ != NULL);
+            }
+        }
+        else if (seqDataJ && LANES == 1) {
+            // Format used before v2.0.0: array of values with run-length encoding
             json_t *seqData1J, *d;
             size_t i;
             json_array_foreach(seqDataJ, i, seqData1J) {
                 if ((int)i >= seqCount) continue;
+                if (!seqData.reserve(i, seqLength[i])) seqLength[i] = seqData.capacity(i);
                 size_t j;
                 float last1 = 100.f, last2 = -100.f;
                 int c = 0;
@@ -743,13 +1085,14 @@ struct ReMoveModule : MapModuleBase<1> {
                     if (last1 == last2) {
                         // we've seen two same values -> decompress!
                         int v = json_integer_value(d);
-                        for (int k = 0; k < v; k++) { seqData[i * s + c] = last1; c++; }
+                        for (int k = 0; k < v && c < seqLength[i]; k++) { seqData.set(i, c, 0, last1); c++; }
                         last1 = 100.f; last2 = -100.f;
                     }
-                    else {
-                        seqData[i * s + c] = json_real_value(d);
+                    else if (c < seqLength[i]) {
+                        float v = json_real_value(d);
+                        seqData.set(i, c, 0, v);
                         last2 = last1;
-                        last1 = seqData[i * s + c];
+                        last1 = v;
                         c++;
                     }
                 }
@@ -757,7 +1100,8 @@ struct ReMoveModule : MapModuleBase<1> {
         }
 
         isRecording = false;
-        params[REC_PARAM].setValue(0);
+        playFrameValid = false;
+        this->params[REC_PARAM].setValue(0);
         seqUpdate();
     }
 
@@ -768,24 +1112,27 @@ struct ReMoveModule : MapModuleBase<1> {
         dsp::ExponentialFilter filter;
         filter.setLambda(sampleRate * 10.f);
 
-        int s = REMOVE_MAX_DATA / seqCount;
         // Generate maximum of 4 seconds random data
-        int l = std::min((int)round(1.f / sampleRate * 8.f), s);
+        int l = std::min((int)round(1.f / sampleRate * 8.f), REMOVE_MAX_DATA / seqCount);
+        seqData.clear();
 
         for (int i = 0; i < seqCount; i++) {
-            // Set some start-value for the exponential filter
-            filter.out = 0.5f + d(gen) * 10.f;
-            float dir = 1.f;
-            float p = 0.5f;
-            for (int c = 0; c < l; c++) {
-                // Reduce the number of direction changes, only when rand > 0
-                if (c % (l / 8) == 0) dir = d(gen) >= 0 ? 1 : -1;
-                float r = d(gen);
-                // Inject some static in the curve
-                p = filter.process(1.f, r >= 0.005f ? p + dir * abs(r) : p);
-                // Only range [0,1] is valid
-                p = clamp(p, 0.f, 1.f);
-                seqData[i * s + c] = p;
+            seqData.reserve(i, l);
+            for (int lane = 0; lane < LANES; lane++) {
+                // Set some start-value for the exponential filter
+                filter.out = 0.5f + d(gen) * 10.f;
+                float dir = 1.f;
+                float p = 0.5f;
+                for (int c = 0; c < l; c++) {
+                    // Reduce the number of direction changes, only when rand > 0
+                    if (c % (l / 8) == 0) dir = d(gen) >= 0 ? 1 : -1;
+                    float r = d(gen);
+                    // Inject some static in the curve
+                    p = filter.process(1.f, r >= 0.005f ? p + dir * abs(r) : p);
+                    // Only range [0,1] is valid
+                    p = clamp(p, 0.f, 1.f);
+                    seqData.set(i, c, lane, p);
+                }
             }
             seqLength[i] = l;
         }
@@ -793,8 +1140,9 @@ struct ReMoveModule : MapModuleBase<1> {
 };
 
 
+template < int LANES >
 struct ReMoveDisplay : TransparentWidget {
-    ReMoveModule *module;
+    ReMoveModule<LANES> *module;
 
     void drawLayer(const DrawArgs& args, int layer) override {
         if (!module) return;
@@ -810,12 +1158,12 @@ struct ReMoveDisplay : TransparentWidget {
             nvgClosePath(args.vg);
             nvgStroke(args.vg);
 
-            int seqPos = module->dataPtr - module->seqLow;
+            int seqPos = module->dataPtr;
 
             if (module->isRecording) {
                 // Draw text showing remaining time
                 std::shared_ptr<Font> font = APP->window->loadFont(asset::system("res/fonts/ShareTechMono-Regular.ttf"));
-                float t = ((float)REMOVE_MAX_DATA / (float)module->seqCount - (float)seqPos) * module->sampleRate;
+                float t = (float)(module->seqData.available(module->seq) - seqPos) * module->sampleRate;
                 nvgFontSize(args.vg, 11);
                 nvgFontFaceId(args.vg, font->handle);
                 nvgTextLetterSpacing(args.vg, -2.2);
@@ -837,29 +1185,31 @@ struct ReMoveDisplay : TransparentWidget {
                 nvgStroke(args.vg);
             }
 
-            // Draw automation-line
-            nvgStrokeColor(args.vg, nvgRGB(0xd8, 0xd8, 0xd8));
+            // Draw automation-lines, the first lane on top
             nvgSave(args.vg);
             Rect b = Rect(Vec(0, 2), Vec(maxX, maxY - 4));
             nvgScissor(args.vg, b.pos.x, b.pos.y, b.size.x, b.size.y);
-            nvgBeginPath(args.vg);
-            int c = std::min(seqLength, 120);
-            for (int i = 0; i < c; i++) {
-                float x = (float)i / (c - 1);
-                float y = module->seqData[module->seqLow + (int)floor(x * (seqLength - 1))] * 0.96f + 0.02f;
-                float px = b.pos.x + b.size.x * x;
-                float py = b.pos.y + b.size.y * (1.0 - y);
-                if (i == 0)
-                    nvgMoveTo(args.vg, px, py);
-                else
-                    nvgLineTo(args.vg, px, py);
-            }
+            for (int lane = LANES - 1; lane >= 0; lane--) {
+                nvgStrokeColor(args.vg, lane == 0 ? nvgRGB(0xd8, 0xd8, 0xd8) : nvgRGBA(0xd8, 0xd8, 0xd8, 0x60));
+                nvgBeginPath(args.vg);
+                int c = std::min(seqLength, 120);
+                for (int i = 0; i < c; i++) {
+                    float x = (float)i / (c - 1);
+                    float y = module->seqData.get(module->seq, (int)floor(x * (seqLength - 1)), lane) * 0.96f + 0.02f;
+                    float px = b.pos.x + b.size.x * x;
+                    float py = b.pos.y + b.size.y * (1.0 - y);
+                    if (i == 0)
+                        nvgMoveTo(args.vg, px, py);
+                    else
+                        nvgLineTo(args.vg, px, py);
+                }
 
-            nvgLineCap(args.vg, NVG_ROUND);
-            nvgMiterLimit(args.vg, 2.0);
-            nvgStrokeWidth(args.vg, 1.0);
-            nvgGlobalCompositeOperation(args.vg, NVG_LIGHTER);
-            nvgStroke(args.vg);
+                nvgLineCap(args.vg, NVG_ROUND);
+                nvgMiterLimit(args.vg, 2.0);
+                nvgStrokeWidth(args.vg, 1.0);
+                nvgGlobalCompositeOperation(args.vg, NVG_LIGHTER);
+                nvgStroke(args.vg);
+            }
             nvgResetScissor(args.vg);
             nvgRestore(args.vg);
         }
@@ -868,9 +1218,10 @@ struct ReMoveDisplay : TransparentWidget {
 
 
 
+template < class MODULE >
 struct SeqCvModeMenuItem : MenuItem {
     struct SeqCvModeItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         SEQCVMODE seqCvMode;
 
         void onAction(const event::Action &e) override {
@@ -884,7 +1235,7 @@ struct SeqCvModeMenuItem : MenuItem {
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         menu->addChild(construct<SeqCvModeItem>(&MenuItem::text, "0..10V", &SeqCvModeItem::module, module, &SeqCvModeItem::seqCvMode, SEQCVMODE_10V));
@@ -895,9 +1246,10 @@ struct SeqCvModeMenuItem : MenuItem {
 };
 
 
+template < class MODULE >
 struct RunCvModeMenuItem : MenuItem {
     struct RunCvModeItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         RUNCVMODE runCvMode;
 
         void onAction(const event::Action &e) override {
@@ -910,7 +1262,7 @@ struct RunCvModeMenuItem : MenuItem {
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         menu->addChild(construct<RunCvModeItem>(&MenuItem::text, "Gate", &RunCvModeItem::module, module, &RunCvModeItem::runCvMode, RUNCVMODE_GATE));
@@ -919,9 +1271,10 @@ struct RunCvModeMenuItem : MenuItem {
     }
 };
 
+template < class MODULE >
 struct RecOutCvModeMenuItem : MenuItem {
     struct RecOutCvModeItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         RECOUTCVMODE recOutCvMode;
 
         void onAction(const event::Action &e) override {
@@ -935,7 +1288,7 @@ struct RecOutCvModeMenuItem : MenuItem {
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         menu->addChild(construct<RecOutCvModeItem>(&MenuItem::text, "Gate", &RecOutCvModeItem::module, module, &RecOutCvModeItem::recOutCvMode, RECOUTCVMODE_GATE));
@@ -944,8 +1297,9 @@ struct RecOutCvModeMenuItem : MenuItem {
     }
 };
 
+template < class MODULE >
 struct InCvModeMenuItem : MenuItem {
-    ReMoveModule *module;
+    MODULE *module;
 
     void onAction(const event::Action &e) override {
         if (module->isRecording) return;
@@ -959,9 +1313,10 @@ struct InCvModeMenuItem : MenuItem {
 };
 
 
+template < class MODULE >
 struct OutCvModeMenuItem : MenuItem {
     struct OutCvModeItem : MenuItem {
-        ReMoveModule* module;
+        MODULE* module;
         OUTCVMODE outCvMode;
 
         void onAction(const event::Action &e) override {
@@ -975,7 +1330,7 @@ struct OutCvModeMenuItem : MenuItem {
         }
     };
 
-    ReMoveModule* module;
+    MODULE* module;
     Menu* createChildMenu() override {
         Menu* menu = new Menu;
         menu->addChild(construct<OutCvModeItem>(&MenuItem::text, "CV with 0V..10V", &OutCvModeItem::module, module, &OutCvModeItem::outCvMode, OUTCVMODE_CV_UNI));
@@ -986,9 +1341,10 @@ struct OutCvModeMenuItem : MenuItem {
 };
 
 
+template < class MODULE >
 struct SampleRateMenuItem : MenuItem {
     struct SampleRateItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         float sampleRate;
 
         void onAction(const event::Action &e) override {
@@ -998,13 +1354,12 @@ struct SampleRateMenuItem : MenuItem {
 
         void step() override {
             int s1 = REMOVE_MAX_DATA * sampleRate;
-            int s2 = s1 / module->seqCount;
-            rightText = string::f(((module->sampleRate == sampleRate) ? "✔ %ds / %ds" : "%ds / %ds"), s1, s2);
+            rightText = string::f(((module->sampleRate == sampleRate) ? "✔ %ds" : "%ds"), s1);
             MenuItem::step();
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         menu->addChild(construct<SampleRateItem>(&MenuItem::text, "15Hz", &SampleRateItem::module, module, &SampleRateItem::sampleRate, 1.f/15.f));
@@ -1020,9 +1375,10 @@ struct SampleRateMenuItem : MenuItem {
 };
 
 
+template < class MODULE >
 struct SeqCountMenuItem : MenuItem {
     struct SeqCountItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         int seqCount;
 
         void onAction(const event::Action &e) override {
@@ -1036,7 +1392,7 @@ struct SeqCountMenuItem : MenuItem {
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         std::vector<std::string> names = {"1", "2", "4", "8"};
@@ -1048,9 +1404,10 @@ struct SeqCountMenuItem : MenuItem {
 };
 
 
+template < class MODULE >
 struct SeqChangeModeMenuItem : MenuItem {
     struct SeqChangeModeItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         SEQCHANGEMODE seqChangeMode;
 
         void onAction(const event::Action &e) override {
@@ -1063,7 +1420,7 @@ struct SeqChangeModeMenuItem : MenuItem {
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         menu->addChild(construct<SeqChangeModeItem>(&MenuItem::text, "Restart", &SeqChangeModeItem::module, module, &SeqChangeModeItem::seqChangeMode, SEQCHANGEMODE_RESTART));
@@ -1073,9 +1430,10 @@ struct SeqChangeModeMenuItem : MenuItem {
 };
 
 
+template < class MODULE >
 struct RecordModeMenuItem : MenuItem {
     struct RecordModeItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         RECMODE recMode;
 
         void onAction(const event::Action &e) override {
@@ -1089,7 +1447,7 @@ struct RecordModeMenuItem : MenuItem {
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         menu->addChild(construct<RecordModeItem>(&MenuItem::text, "Touch", &RecordModeItem::module, module, &RecordModeItem::recMode, RECMODE_TOUCH));
@@ -1100,8 +1458,9 @@ struct RecordModeMenuItem : MenuItem {
     }
 };
 
+template < class MODULE >
 struct RecAutoplayItem : MenuItem {
-    ReMoveModule *module;
+    MODULE *module;
 
     void onAction(const event::Action &e) override {
         module->recAutoplay ^= true;
@@ -1113,9 +1472,10 @@ struct RecAutoplayItem : MenuItem {
     }
 };
 
+template < class MODULE >
 struct PlayModeMenuItem : MenuItem {
     struct PlayModeItem : MenuItem {
-        ReMoveModule *module;
+        MODULE *module;
         PLAYMODE playMode;
 
         void onAction(const event::Action &e) override {
@@ -1128,7 +1488,7 @@ struct PlayModeMenuItem : MenuItem {
         }
     };
     
-    ReMoveModule *module;
+    MODULE *module;
     Menu *createChildMenu() override {
         Menu *menu = new Menu;
         menu->addChild(construct<PlayModeItem>(&MenuItem::text, "Loop", &PlayModeItem::module, module, &PlayModeItem::playMode, PLAYMODE_LOOP));
@@ -1197,61 +1557,87 @@ struct RecLight : RedLight {
 };
 
 
-struct ReMoveWidget : ThemedModuleWidget<ReMoveModule> {
-    ReMoveWidget(ReMoveModule *module)
-        : ThemedModuleWidget<ReMoveModule>(module, "ReMove") {
-        setModule(module);
+template < int LANES >
+struct ReMoveWidget : ThemedModuleWidget<ReMoveModule<LANES>> {
+    typedef ReMoveModule<LANES> MODULE;
+    Widget* lastDraggedWidget = NULL;
 
-        addChild(createWidget<StoermelderBlackScrew>(Vec(RACK_GRID_WIDTH, 0)));
-        addChild(createWidget<StoermelderBlackScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+    ReMoveWidget(MODULE *module)
+        : ThemedModuleWidget<MODULE>(module, "ReMove") {
+        this->setModule(module);
 
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(19.5f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 0));
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(26.8f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 1));
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(34.1f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 2));
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(41.4f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 3));
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(48.6f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 4));
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(55.9f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 5));
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(63.2f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 6));
-        addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(70.5f, 113.8f), module, ReMoveModule::SEQ_LIGHT + 7));
+        this->addChild(createWidget<StoermelderBlackScrew>(Vec(RACK_GRID_WIDTH, 0)));
+        this->addChild(createWidget<StoermelderBlackScrew>(Vec(this->box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
 
-        addInput(createInputCentered<StoermelderPort>(Vec(68.7f, 243.3f), module, ReMoveModule::RUN_INPUT));
-        addParam(createParamCentered<TL1105>(Vec(45.f, 230.3f), module, ReMoveModule::RUN_PARAM));
-        addChild(createLightCentered<SmallLight<GreenRedLight>>(Vec(76.7f, 260.5f), module, ReMoveModule::RUN_LIGHT));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(19.5f, 113.8f), module, MODULE::SEQ_LIGHT + 0));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(26.8f, 113.8f), module, MODULE::SEQ_LIGHT + 1));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(34.1f, 113.8f), module, MODULE::SEQ_LIGHT + 2));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(41.4f, 113.8f), module, MODULE::SEQ_LIGHT + 3));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(48.6f, 113.8f), module, MODULE::SEQ_LIGHT + 4));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(55.9f, 113.8f), module, MODULE::SEQ_LIGHT + 5));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(63.2f, 113.8f), module, MODULE::SEQ_LIGHT + 6));
+        this->addChild(createLightCentered<TinyLight<WhiteLight>>(Vec(70.5f, 113.8f), module, MODULE::SEQ_LIGHT + 7));
 
-        addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 243.3f), module, ReMoveModule::RESET_INPUT));
-        addParam(createParamCentered<TL1105>(Vec(45.f, 256.3f), module, ReMoveModule::RESET_PARAM));
-        addChild(createLightCentered<SmallLight<GreenRedLight>>(Vec(13.1f, 260.5f), module, ReMoveModule::RESET_LIGHT));
+        this->addInput(createInputCentered<StoermelderPort>(Vec(68.7f, 243.3f), module, MODULE::RUN_INPUT));
+        this->addParam(createParamCentered<TL1105>(Vec(45.f, 230.3f), module, MODULE::RUN_PARAM));
+        this->addChild(createLightCentered<SmallLight<GreenRedLight>>(Vec(76.7f, 260.5f), module, MODULE::RUN_LIGHT));
 
-        addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 327.5f), module, ReMoveModule::CV_INPUT));
-        addOutput(createOutputCentered<StoermelderPort>(Vec(68.7f, 327.5f), module, ReMoveModule::CV_OUTPUT));
+        this->addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 243.3f), module, MODULE::RESET_INPUT));
+        this->addParam(createParamCentered<TL1105>(Vec(45.f, 256.3f), module, MODULE::RESET_PARAM));
+        this->addChild(createLightCentered<SmallLight<GreenRedLight>>(Vec(13.1f, 260.5f), module, MODULE::RESET_LIGHT));
 
-        addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 286.1f), module, ReMoveModule::REC_INPUT));
-        addOutput(createOutputCentered<StoermelderPort>(Vec(68.7f, 286.1f), module, ReMoveModule::REC_OUTPUT));
+        this->addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 327.5f), module, MODULE::CV_INPUT));
+        this->addOutput(createOutputCentered<StoermelderPort>(Vec(68.7f, 327.5f), module, MODULE::CV_OUTPUT));
 
-        addParam(createParamCentered<RecButton>(Vec(45.0f, 151.4f), module, ReMoveModule::REC_PARAM));
-        addChild(createLightCentered<RecLight>(Vec(45.0f, 151.4f), module, ReMoveModule::REC_LIGHT));
+        this->addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 286.1f), module, MODULE::REC_INPUT));
+        this->addOutput(createOutputCentered<StoermelderPort>(Vec(68.7f, 286.1f), module, MODULE::REC_OUTPUT));
 
-        addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 200.1f), module, ReMoveModule::SEQ_INPUT));
-        addParam(createParamCentered<TL1105>(Vec(21.1f, 131.9f), module, ReMoveModule::SEQP_PARAM));
-        addParam(createParamCentered<TL1105>(Vec(68.7f, 131.9), module, ReMoveModule::SEQN_PARAM));
-        addParam(createParamCentered<StoermelderTrimpot>(Vec(45.0f, 187.2f), module, ReMoveModule::SLEW_PARAM));
-        addInput(createInputCentered<StoermelderPort>(Vec(68.7f, 200.1f), module, ReMoveModule::PHASE_INPUT));
+        this->addParam(createParamCentered<RecButton>(Vec(45.0f, 151.4f), module, MODULE::REC_PARAM));
+        this->addChild(createLightCentered<RecLight>(Vec(45.0f, 151.4f), module, MODULE::REC_LIGHT));
 
-        MapModuleDisplay<1, ReMoveModule> *mapWidget = createWidget<MapModuleDisplay<1, ReMoveModule>>(Vec(6.8f, 36.4f));
+        this->addInput(createInputCentered<StoermelderPort>(Vec(21.1f, 200.1f), module, MODULE::SEQ_INPUT));
+        this->addParam(createParamCentered<TL1105>(Vec(21.1f, 131.9f), module, MODULE::SEQP_PARAM));
+        this->addParam(createParamCentered<TL1105>(Vec(68.7f, 131.9), module, MODULE::SEQN_PARAM));
+        this->addParam(createParamCentered<StoermelderTrimpot>(Vec(45.0f, 187.2f), module, MODULE::SLEW_PARAM));
+        this->addInput(createInputCentered<StoermelderPort>(Vec(68.7f, 200.1f), module, MODULE::PHASE_INPUT));
+
+        MapModuleDisplay<LANES, MODULE> *mapWidget = createWidget<MapModuleDisplay<LANES, MODULE>>(Vec(6.8f, 36.4f));
         mapWidget->box.size = Vec(76.2f, 23.f);
         mapWidget->setModule(module);
-        addChild(mapWidget);
+        this->addChild(mapWidget);
 
-        ReMoveDisplay *display = new ReMoveDisplay();
+        ReMoveDisplay<LANES> *display = new ReMoveDisplay<LANES>();
         display->module = module;
         display->box.pos = Vec(6.8f, 65.7f);
         display->box.size = Vec(76.2f, 41.6f);
-        addChild(display); 
+        this->addChild(display); 
+    }
+
+    void step() override {
+        ThemedModuleWidget<MODULE>::step();
+        MODULE *module = dynamic_cast<MODULE*>(this->module);
+        if (!module) return;
+
+        // Memory for recording is allocated ahead on the UI thread, only as long as recording is armed
+        if (module->isRecording) module->seqData.allocateSpare();
+        else module->seqData.releaseSpare();
+
+        // Touch detection for the record mode "Touch" is done on the UI thread,
+        // casting is needed only when the dragged widget changes
+        Widget* w = APP->event->getDraggedWidget();
+        if (w != lastDraggedWidget) {
+            lastDraggedWidget = w;
+            ParamWidget* pw = dynamic_cast<ParamWidget*>(w);
+            bool touched = pw != NULL && module->isLaneParamQuantity(pw->getParamQuantity());
+            if (touched) module->uiTouchFrame = APP->engine->getFrame();
+            module->uiTouched = touched;
+            module->uiDragged = w != NULL;
+        }
     }
 
     void appendContextMenu(Menu *menu) override {
-        ThemedModuleWidget<ReMoveModule>::appendContextMenu(menu);
-        ReMoveModule *module = dynamic_cast<ReMoveModule*>(this->module);
+        ThemedModuleWidget<MODULE>::appendContextMenu(menu);
+        MODULE *module = dynamic_cast<MODULE*>(this->module);
         assert(module);
 
         menu->addChild(new MenuSeparator());
@@ -1259,49 +1645,58 @@ struct ReMoveWidget : ThemedModuleWidget<ReMoveModule> {
 
         menu->addChild(new MenuSeparator());
 
-        SampleRateMenuItem *sampleRateMenuItem = construct<SampleRateMenuItem>(&MenuItem::text, "Sample rate", &SampleRateMenuItem::module, module);
+        SampleRateMenuItem<MODULE> *sampleRateMenuItem = construct<SampleRateMenuItem<MODULE>>(&MenuItem::text, "Sample rate", &SampleRateMenuItem<MODULE>::module, module);
         sampleRateMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(sampleRateMenuItem);
 
-        SeqCountMenuItem *seqCountMenuItem = construct<SeqCountMenuItem>(&MenuItem::text, "# of sequences", &SeqCountMenuItem::module, module);
+        SeqCountMenuItem<MODULE> *seqCountMenuItem = construct<SeqCountMenuItem<MODULE>>(&MenuItem::text, "# of sequences", &SeqCountMenuItem<MODULE>::module, module);
         seqCountMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(seqCountMenuItem);
 
-        SeqChangeModeMenuItem *seqChangeModeMenuItem = construct<SeqChangeModeMenuItem>(&MenuItem::text, "Sequence change mode", &SeqChangeModeMenuItem::module, module);
+        SeqChangeModeMenuItem<MODULE> *seqChangeModeMenuItem = construct<SeqChangeModeMenuItem<MODULE>>(&MenuItem::text, "Sequence change mode", &SeqChangeModeMenuItem<MODULE>::module, module);
         seqChangeModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(seqChangeModeMenuItem);
 
-        RecordModeMenuItem *recordModeMenuItem = construct<RecordModeMenuItem>(&MenuItem::text, "Record mode", &RecordModeMenuItem::module, module);
+        RecordModeMenuItem<MODULE> *recordModeMenuItem = construct<RecordModeMenuItem<MODULE>>(&MenuItem::text, "Record mode", &RecordModeMenuItem<MODULE>::module, module);
         recordModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(recordModeMenuItem);
 
-        RecAutoplayItem *recAutoplayItem = construct<RecAutoplayItem>(&MenuItem::text, "Autoplay after record", &RecAutoplayItem::module, module);
+        RecAutoplayItem<MODULE> *recAutoplayItem = construct<RecAutoplayItem<MODULE>>(&MenuItem::text, "Autoplay after record", &RecAutoplayItem<MODULE>::module, module);
         recAutoplayItem->rightText = RIGHT_ARROW;
         menu->addChild(recAutoplayItem);
 
-        PlayModeMenuItem *playModeMenuItem = construct<PlayModeMenuItem>(&MenuItem::text, "Play mode", &PlayModeMenuItem::module, module);
+        PlayModeMenuItem<MODULE> *playModeMenuItem = construct<PlayModeMenuItem<MODULE>>(&MenuItem::text, "Play mode", &PlayModeMenuItem<MODULE>::module, module);
         playModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(playModeMenuItem);
 
+        menu->addChild(StoermelderPackOne::Rack::createMapPtrSubmenuItem<INTERPOLATION>("Interpolation",
+            {
+                { INTERPOLATION_NONE, "None" },
+                { INTERPOLATION_LINEAR, "Linear" },
+                { INTERPOLATION_CUBIC, "Cubic" }
+            },
+            &module->interpolation
+        ));
+
         menu->addChild(new MenuSeparator());
 
-        SeqCvModeMenuItem *seqCvModeMenuItem = construct<SeqCvModeMenuItem>(&MenuItem::text, "Port SEQ# mode", &SeqCvModeMenuItem::module, module);
+        SeqCvModeMenuItem<MODULE> *seqCvModeMenuItem = construct<SeqCvModeMenuItem<MODULE>>(&MenuItem::text, "Port SEQ# mode", &SeqCvModeMenuItem<MODULE>::module, module);
         seqCvModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(seqCvModeMenuItem);
 
-        RunCvModeMenuItem *runCvModeMenuItem = construct<RunCvModeMenuItem>(&MenuItem::text, "Port RUN mode", &RunCvModeMenuItem::module, module);
+        RunCvModeMenuItem<MODULE> *runCvModeMenuItem = construct<RunCvModeMenuItem<MODULE>>(&MenuItem::text, "Port RUN mode", &RunCvModeMenuItem<MODULE>::module, module);
         runCvModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(runCvModeMenuItem);
 
-        RecOutCvModeMenuItem *recOutCvModeMenuItem = construct<RecOutCvModeMenuItem>(&MenuItem::text, "Port REC-out mode", &RecOutCvModeMenuItem::module, module);
+        RecOutCvModeMenuItem<MODULE> *recOutCvModeMenuItem = construct<RecOutCvModeMenuItem<MODULE>>(&MenuItem::text, "Port REC-out mode", &RecOutCvModeMenuItem<MODULE>::module, module);
         recOutCvModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(recOutCvModeMenuItem);
 
-        InCvModeMenuItem *inCvModeMenuItem = construct<InCvModeMenuItem>(&MenuItem::text, "Port IN voltage", &InCvModeMenuItem::module, module);
+        InCvModeMenuItem<MODULE> *inCvModeMenuItem = construct<InCvModeMenuItem<MODULE>>(&MenuItem::text, "Port IN voltage", &InCvModeMenuItem<MODULE>::module, module);
         inCvModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(inCvModeMenuItem);
 
-        OutCvModeMenuItem *outCvModeMenuItem = construct<OutCvModeMenuItem>(&MenuItem::text, "Port OUT voltage", &OutCvModeMenuItem::module, module);
+        OutCvModeMenuItem<MODULE> *outCvModeMenuItem = construct<OutCvModeMenuItem<MODULE>>(&MenuItem::text, "Port OUT voltage", &OutCvModeMenuItem<MODULE>::module, module);
         outCvModeMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(outCvModeMenuItem);
     }
@@ -1310,4 +1705,4 @@ struct ReMoveWidget : ThemedModuleWidget<ReMoveModule> {
 } // namespace ReMove
 } // namespace StoermelderPackOne
 
-Model *modelReMoveLite = createModel<StoermelderPackOne::ReMove::ReMoveModule, StoermelderPackOne::ReMove::ReMoveWidget>("ReMoveLite");
\ No newline at end of file
+Model *modelReMoveLite = createModel<StoermelderPackOne::ReMove::ReMoveModule<1>, StoermelderPackOne::ReMove::ReMoveWidget<1>>("ReMoveLite");
\ No newline at end of file
@@ -69,6 +69,8 @@ struct StripModule : StripModuleBase {
 
 	dsp::ClockDivider lightDivider;
 
+	/** Switching requested by groupDisable(), bit 0 for the state, bit 1 for using history, -1 if none */
+	std::atomic<int> dispatchDisable{-1};
 	TaskWorker taskWorker;
 
 	StripModule() {
@@ -85,6 +87,7 @@ struct StripModule : StripModuleBase {
 
 		lightDivider.setDivision(1024);
 		onReset();
+		taskWorker.postTask([this]() { dispatchWorker(); });
 	}
 
 	void onReset() override {
@@ -136,6 +139,16 @@ struct StripModule : StripModuleBase {
 	}
 
 	void groupDisable(bool val, bool useHistory) {
+		dispatchDisable = (val ? 1 : 0) | (useHistory ? 2 : 0);
+		taskWorker.post();
+	}
+
+	/** Submits the switching requested by groupDisable() on the engine-thread */
+	void dispatchWorker() {
+		int d = dispatchDisable.exchange(-1);
+		if (d < 0) return;
+		bool val = d & 1;
+		bool useHistory = d & 2;
 		taskWorker.work([=]() { groupDisableWorker(val, useHistory); });
 	}
 
@@ -2,7 +2,8 @@
 #include "digital.hpp"
 #include "TransitBase.hpp"
 #include "digital/ShapedSlewLimiter.hpp"
-#include "helpers/TaskProcessor.hpp"
+#include "helpers/CommandQueue.hpp"
+#include "helpers/LatencyHistogram.hpp"
 #include "components/Knobs.hpp"
 #include "components/ParamHandleIndicator.hpp"
 #include <random>
@@ -38,6 +39,13 @@ enum class OUTMODE {
 	PHASE = 5
 };
 
+/** Tasks run on the UI-thread as the engine's mutex could already be locked, pushed as sticky commands run in this order */
+enum class UI_CMD {
+	CLEAN_HANDLES,
+	CREATE_HANDLES,
+	RESERVE_SLOTS
+};
+
 template <int NUM_PRESETS>
 struct TransitModule : TransitBase<NUM_PRESETS> {
 	typedef TransitBase<NUM_PRESETS> BASE;
@@ -72,14 +80,23 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 	int presetCount;
 
 	/** Total number of snapshots including expanders */
-	int presetTotal;
+	int presetTotal = 0;
 	int presetNext;
 	int presetCopy = -1;
 	float presetPhaseLast = -1.f;
 
-	/** Holds the last values on transitions */
+	/** Values on transitions, sized by presetBufferResize() on mapping changes and never resized in process(),
+	 * padded to multiples of 4 for SIMD-processing */
 	std::vector<float> presetOld;
 	std::vector<float> presetNew;
+	std::vector<float> presetDelta;
+	std::vector<float> presetValue;
+	/** Resolved parameters of sourceHandles with the module and generation they were resolved for, see sourceParam() */
+	std::vector<Param*> sourceParamCache;
+	std::vector<Module*> sourceParamModule;
+	std::vector<uint32_t> sourceParamGeneration;
+	/** Incremented for resolving all parameters again */
+	uint32_t sourceGeneration = 0;
 
 	/** [Stored to JSON] mode for SEQ CV input */
 	SLOTCVMODE slotCvMode = SLOTCVMODE::TRIG_FWD;
@@ -92,6 +109,11 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 	OUTMODE outMode;
 	bool outEocArm;
 	bool processing = false;
+	int64_t engineFrame = 0;
+	/** Frame of the trigger of a recall not applied yet, -1 otherwise */
+	int64_t recallFrame = -1;
+	/** Engine time from the trigger until the first update of the parameters */
+	LatencyHistogram recallLatency;
 	dsp::PulseGenerator outSlotPulseGenerator;
 	dsp::PulseGenerator outSocPulseGenerator;
 	dsp::PulseGenerator outEocPulseGenerator;
@@ -124,9 +146,14 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 
 	int sampleRate;
 
+	/** Resolved expander-chain, updated in expUpdateChain() only */
 	TransitBase<NUM_PRESETS>* N[MAX_EXPANDERS + 1];
+	int expCount = 0;
+	int expPanelTheme = -1;
 	
-	TaskProcessor<> taskProcessorUi;
+	CommandQueue<UI_CMD> uiCommands;
+	/** Parameters to be mapped by UI_CMD::CREATE_HANDLES */
+	std::vector<std::pair<int64_t, int>> uiHandlesPending;
 
 	TransitModule() {
 		BASE::panelTheme = pluginSettings.panelThemeDefault;
@@ -166,18 +193,9 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 	void reset(bool stateOnly, bool createUiTask = false) {
 		if (!stateOnly) {
 			inChange = true;
-			auto cleanHandles = [=]() {
-				for (ParamHandle* sourceHandle : sourceHandles) {
-					APP->engine->removeParamHandle(sourceHandle);
-					delete sourceHandle;
-				}
-				sourceHandles.clear();
-				inChange = false;
-			};
-
 			// Enqueue on the UI-thread as the engine's mutex could already be locked
 			if (createUiTask) {
-				taskProcessorUi.enqueue(cleanHandles);
+				uiCommands.pushSticky(UI_CMD::CLEAN_HANDLES);
 			}
 			else {
 				cleanHandles();
@@ -235,31 +253,109 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		return &N[n]->textLabel[index % NUM_PRESETS];
 	}
 
-	void process(const Module::ProcessArgs& args) override {
-		if (inChange) return;
-		sampleRate = args.sampleRate;
+	void onExpanderChange(const Module::ExpanderChangeEvent& e) override {
+		if (e.side == 1) BASE::expChainChanged = true;
+	}
 
-		presetTotal = NUM_PRESETS;
+	/** Resolves the expanders on the right side, called on the engine thread after expander changes */
+	void expUpdateChain() {
+		N[0] = this;
+		expCount = 1;
 		Module* m = this;
-		TransitBase<NUM_PRESETS>* t = this;
-		t->ctrlMode = (CTRLMODE)Module::params[PARAM_CTRLMODE].getValue();
-		int c = 0;
-		while (true) {
-			N[c] = t;
-			c++;
-			if (c == MAX_EXPANDERS + 1) break;
-
+		while (expCount < MAX_EXPANDERS + 1) {
 			Module* exp = m->rightExpander.module;
 			if (!exp) break;
 			if (exp->model != modelTransitEx) break;
 			m = exp;
-			t = reinterpret_cast<TransitBase<NUM_PRESETS>*>(exp);
+			TransitBase<NUM_PRESETS>* t = reinterpret_cast<TransitBase<NUM_PRESETS>*>(exp);
 			if (t->ctrlModuleId >= 0 && t->ctrlModuleId != Module::id) t->onReset();
-			t->panelTheme = BASE::panelTheme;
 			t->ctrlModuleId = Module::id;
-			t->ctrlOffset = c;
-			t->ctrlMode = BASE::ctrlMode;
-			presetTotal += NUM_PRESETS;
+			t->ctrlOffset = expCount;
+			t->expChainChanged = false;
+			N[expCount] = t;
+			expCount++;
+		}
+		presetTotal = expCount * NUM_PRESETS;
+		// Force syncing of the expanders' state
+		expPanelTheme = -1;
+		// Added expanders must not allocate when saving a snapshot, pause until the UI-thread has reserved their slots
+		size_t n = sourceHandles.size();
+		for (int i = 0; i < presetTotal; i++) {
+			if (expSlot(i)->preset->capacity() < n) {
+				if (settings::headless) {
+					// No UI-thread is running, so there is no other place to allocate
+					presetBufferReserve();
+					break;
+				}
+				// The UI-thread might run the command right away, so the flag is set first
+				inChange = true;
+				uiCommands.pushSticky(UI_CMD::RESERVE_SLOTS);
+				break;
+			}
+		}
+	}
+
+	void cleanHandles() {
+		for (ParamHandle* sourceHandle : sourceHandles) {
+			APP->engine->removeParamHandle(sourceHandle);
+			delete sourceHandle;
+		}
+		sourceHandles.clear();
+		presetBufferResize();
+		inChange = false;
+	}
+
+	void createHandles() {
+		for (std::pair<int64_t, int>& p : uiHandlesPending) {
+			ParamHandleIndicator* sourceHandle = new ParamHandleIndicator;
+			sourceHandle->text = "stoermelder TRANSIT";
+			APP->engine->addParamHandle(sourceHandle);
+			APP->engine->updateParamHandle(sourceHandle, p.first, p.second, false);
+			sourceHandles.push_back(sourceHandle);
+		}
+		uiHandlesPending.clear();
+		presetBufferResize();
+		inChange = false;
+	}
+
+	/** Runs the tasks enqueued for the UI-thread, called from the widget's step() */
+	void processUi() {
+		uiCommands.process([this](UI_CMD cmd) {
+			switch (cmd) {
+				case UI_CMD::CLEAN_HANDLES:
+					cleanHandles();
+					break;
+				case UI_CMD::CREATE_HANDLES:
+					createHandles();
+					break;
+				case UI_CMD::RESERVE_SLOTS:
+					presetBufferReserve();
+					inChange = false;
+					break;
+			}
+		});
+	}
+
+	void process(const Module::ProcessArgs& args) override {
+		if (inChange) return;
+		sampleRate = args.sampleRate;
+		// Modules might have been removed and added again while process() wasn't called, e.g. while bypassed
+		if (args.frame != engineFrame + 1) sourceGeneration++;
+		engineFrame = args.frame;
+
+		if (BASE::expChainChanged) {
+			BASE::expChainChanged = false;
+			expUpdateChain();
+			sourceGeneration++;
+		}
+		CTRLMODE ctrlMode = (CTRLMODE)Module::params[PARAM_CTRLMODE].getValue();
+		if (ctrlMode != BASE::ctrlMode || BASE::panelTheme != expPanelTheme) {
+			BASE::ctrlMode = ctrlMode;
+			expPanelTheme = BASE::panelTheme;
+			for (int c = 1; c < expCount; c++) {
+				N[c]->panelTheme = BASE::panelTheme;
+				N[c]->ctrlMode = ctrlMode;
+			}
 		}
 		int presetCount = std::min(this->presetCount, presetTotal);
 
@@ -530,18 +626,61 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		sourceHandle->text = "stoermelder TRANSIT";
 		APP->engine->addParamHandle(sourceHandle);
 		APP->engine->updateParamHandle(sourceHandle, moduleId, paramId, true);
-		inChange = true;
-		sourceHandles.push_back(sourceHandle);
-		inChange = false;
-
 		ParamQuantity* pq = getParamQuantity(sourceHandle);
 		float v = pq ? pq->getValue() : 0.f;
+
+		inChange = true;
+		sourceHandles.push_back(sourceHandle);
+		presetBufferResize();
 		for (int i = 0; i < presetTotal; i++) {
 			TransitSlot* slot = expSlot(i);
 			if (!*(slot->presetSlotUsed)) continue;
 			slot->preset->push_back(v);
 			assert(sourceHandles.size() == slot->preset->size());
 		}
+		inChange = false;
+	}
+
+	// Always called from the UI-thread while inChange is set
+	void presetBufferResize() {
+		size_t n = sourceHandles.size();
+		size_t n4 = (n + 3) / 4 * 4;
+		presetOld.assign(n4, 0.f);
+		presetNew.assign(n4, 0.f);
+		presetDelta.assign(n4, 0.f);
+		presetValue.assign(n4, 0.f);
+		sourceParamCache.assign(n, NULL);
+		sourceParamModule.assign(n, NULL);
+		sourceParamGeneration.assign(n, 0);
+		sourceGeneration++;
+		presetBufferReserve();
+		// A running transition has no values for new parameters
+		processing = false;
+	}
+
+	/** Saving a snapshot refills the slot, make sure it won't allocate. Covers all slots of the chain,
+	 * expanders added later are reserved by UI_CMD::RESERVE_SLOTS, see expUpdateChain() */
+	void presetBufferReserve() {
+		size_t n = sourceHandles.size();
+		for (int i = 0; i < presetTotal; i++) {
+			expSlot(i)->preset->reserve(n);
+		}
+	}
+
+	/** Returns the Param of sourceHandles[i], resolved again when the handle's module has changed or
+	 * the cache has been invalidated. Rack clears the handle of a removed module, which is seen here as
+	 * long as process() runs; gaps in the engine's frames and mapping or expander changes invalidate
+	 * the cache, so a module removed and restored at the same address isn't mistaken for the old one. */
+	inline Param* sourceParam(size_t i) {
+		ParamHandle* h = sourceHandles[i];
+		Module* m = h->module;
+		if (m != sourceParamModule[i] || sourceParamGeneration[i] != sourceGeneration) {
+			sourceParamModule[i] = m;
+			sourceParamGeneration[i] = sourceGeneration;
+			bool valid = m && h->paramId >= 0 && h->paramId < (int)m->params.size();
+			sourceParamCache[i] = valid ? &m->params[h->paramId] : NULL;
+		}
+		return sourceParamCache[i];
 	}
 
 	void presetLoad(int p, bool isNext = false, bool force = false) {
@@ -557,14 +696,15 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 				outSlotPulseGenerator.trigger();
 				if (!*(slot->presetSlotUsed)) 
 					return;
+				size_t n = sourceHandles.size();
 				if (BASE::ctrlMode == CTRLMODE::AUTO && presetPrev != -1) {
 					TransitSlot* slotPrev = expSlot(presetPrev);
 					if (*(slotPrev->presetSlotUsed)) {
-						slotPrev->preset->clear();
-						for (size_t i = 0; i < sourceHandles.size(); i++) {
-							ParamQuantity* pq = getParamQuantity(sourceHandles[i]);
-							float v = pq ? pq->getValue() : 0.f;
-							slotPrev->preset->push_back(v);
+						// Used slots hold a value for every mapped parameter, overwrite them in place
+						std::vector<float>& prev = *(slotPrev->preset);
+						for (size_t i = 0; i < std::min(n, prev.size()); i++) {
+							Param* param = sourceParam(i);
+							prev[i] = param ? param->getValue() : 0.f;
 						}
 					}
 				}
@@ -572,14 +712,13 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 				outSocPulseGenerator.trigger();
 				outEocArm = true;
 				processing = true;
-				presetOld.clear();
-				presetNew.clear();
-				for (size_t i = 0; i < sourceHandles.size(); i++) {
-					ParamQuantity* pq = getParamQuantity(sourceHandles[i]);
-					presetOld.push_back(pq ? pq->getValue() : 0.f);
-					if (slot->preset->size() > i) {
-						presetNew.push_back((*(slot->preset))[i]);
-					}
+				recallFrame = engineFrame;
+				std::vector<float>& next = *(slot->preset);
+				for (size_t i = 0; i < n; i++) {
+					Param* param = sourceParam(i);
+					presetOld[i] = param ? param->getValue() : 0.f;
+					presetNew[i] = i < next.size() ? next[i] : presetOld[i];
+					presetDelta[i] = presetNew[i] - presetOld[i];
 				}
 			}
 		}
@@ -639,19 +778,33 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 			}
 
 			float s10 = s / 10.f;
-			for (size_t i = 0; i < sourceHandles.size(); i++) {
-				ParamQuantity* pq = getParamQuantity(sourceHandles[i]);
-				if (!pq) continue;
-				if (presetOld.size() <= i) return;
-				float oldValue = presetOld[i];
-				if (presetNew.size() <= i) return;
-				float newValue = presetNew[i];
-				float v = crossfade(oldValue, newValue, s10);
-				if (s10 > (1.f - 5e-3f) && std::abs(std::round(v) - v) < 5e-3f) v = std::round(v);
-				//pq->setValue(v);
-				pq->getParam()->setValue(v);
+			size_t n = sourceHandles.size();
+			if (s == 10.f) {
+				std::copy(presetNew.begin(), presetNew.end(), presetValue.begin());
+			}
+			else {
+				simd::float_4 s4 = s10;
+				bool snap = s10 > (1.f - 5e-3f);
+				for (size_t i = 0; i < n; i += 4) {
+					simd::float_4 v = simd::float_4::load(&presetOld[i]) + simd::float_4::load(&presetDelta[i]) * s4;
+					if (snap) {
+						// Snap values close to integers at the end of the fade
+						simd::float_4 r = simd::round(v);
+						v = simd::ifelse(simd::fabs(r - v) < 5e-3f, r, v);
+					}
+					v.store(&presetValue[i]);
+				}
+			}
+			for (size_t i = 0; i < n; i++) {
+				Param* param = sourceParam(i);
+				if (!param) continue;
+				param->setValue(presetValue[i]);
 			}
 
+			if (recallFrame >= 0) {
+				recallLatency.add((engineFrame - recallFrame) * sampleTime);
+				recallFrame = -1;
+			}
 			if (s == 10.f) {
 				processing = false;
 			}
@@ -695,24 +848,10 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 			
 			if (p1 != p2) {
 				p = (p - float(p1)) / (float(p2) - float(p1));
-				for (size_t i = 0; i < sourceHandles.size(); i++) {
-					ParamQuantity* pq = getParamQuantity(sourceHandles[i]);
-					if (!pq) continue;
-					float v1 = (*slot1->preset)[i];
-					float v2 = (*slot2->preset)[i];
-					float v = crossfade(v1, v2, p);
-					//pq->setValue(v);
-					pq->getParam()->setValue(v);
-				}
+				presetMorph(*slot1->preset, *slot2->preset, p);
 			}
 			else {
-				for (size_t i = 0; i < sourceHandles.size(); i++) {
-					ParamQuantity* pq = getParamQuantity(sourceHandles[i]);
-					if (!pq) continue;
-					float v = (*slot1->preset)[i];
-					//pq->setValue(v);
-					pq->getParam()->setValue(v);
-				}
+				presetMorph(*slot1->preset, *slot1->preset, 0.f);
 			}
 
 			BASE::outputs[OUTPUT].setVoltage(presetPhaseLast / (presetCount - 1) * 10.f);
@@ -720,6 +859,26 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		}
 	}
 
+	/** Writes the values between two adjacent snapshots to the bound parameters */
+	void presetMorph(const std::vector<float>& v1, const std::vector<float>& v2, float t) {
+		size_t n = std::min(sourceHandles.size(), std::min(v1.size(), v2.size()));
+		simd::float_4 t4 = t;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			simd::float_4 a = simd::float_4::load(&v1[i]);
+			simd::float_4 b = simd::float_4::load(&v2[i]);
+			(a + (b - a) * t4).store(&presetValue[i]);
+		}
+		for (; i < n; i++) {
+			presetValue[i] = v1[i] + (v2[i] - v1[i]) * t;
+		}
+		for (i = 0; i < n; i++) {
+			Param* param = sourceParam(i);
+			if (!param) continue;
+			param->setValue(presetValue[i]);
+		}
+	}
+
 	void presetSave(int p) {
 		TransitSlot* slot = expSlot(p);
 		*(slot->presetSlotUsed) = true;
@@ -900,7 +1059,7 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		}
 
 		inChange = true;
-		std::list<std::function<void()>> handleList;
+		uiHandlesPending.clear();
 
 		json_t* sourceMapsJ = json_object_get(rootJ, "sourceMaps");
 		if (sourceMapsJ) {
@@ -913,24 +1072,15 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 				int paramId = json_integer_value(paramIdJ);
 				moduleId = BASE::idFix(moduleId);
 
-				// This might cause a deadlock as the engine's mutex could already be locked
-				handleList.push_back([=]() {
-					ParamHandleIndicator* sourceHandle = new ParamHandleIndicator;
-					sourceHandle->text = "stoermelder TRANSIT";
-					APP->engine->addParamHandle(sourceHandle);
-					APP->engine->updateParamHandle(sourceHandle, moduleId, paramId, false);
-					sourceHandles.push_back(sourceHandle);
-				});
+				// Creating the handle here might cause a deadlock as the engine's mutex could already be locked
+				uiHandlesPending.push_back(std::make_pair(moduleId, paramId));
 			}
 		}
 
 		BASE::idFixClearMap();
 
 		// Enqueue on the UI-thread for creating ParamHandles
-		taskProcessorUi.enqueue([=]() {
-			for (std::function<void()> f : handleList) f();
-			inChange = false;
-		});
+		uiCommands.pushSticky(UI_CMD::CREATE_HANDLES);
 
 		BASE::dataFromJson(rootJ);
 		Module::params[PARAM_CTRLMODE].setValue(0.f);
@@ -1044,7 +1194,7 @@ struct TransitWidget : ThemedModuleWidget<TransitModule<NUM_PRESETS>> {
 			BASE::module->lights[MODULE::LIGHT_LEARN].setBrightness(learn > 0);
 		}
 		BASE::step();
-		if (BASE::module) BASE::module->taskProcessorUi.process();
+		if (BASE::module) BASE::module->processUi();
 	}
 
 	void enableLearn(int mode) {
@@ -1303,6 +1453,7 @@ struct TransitWidget : ThemedModuleWidget<TransitModule<NUM_PRESETS>> {
 			menu->addChild(new MenuSeparator());
 			menu->addChild(construct<ModuleMenuItem>(&MenuItem::text, "Bound modules", &ModuleMenuItem::module, module));
 			menu->addChild(construct<ParameterMenuItem>(&MenuItem::text, "Bound parameters", &ParameterMenuItem::module, module));
+			menu->addChild(createLatencyMenuItem("Recall latency", &module->recallLatency));
 		}
 	}
 };
@@ -32,6 +32,83 @@ struct TransitSlot {
 	LongPressButton* presetButton;
 };
 
+/** Encodes the values of a snapshot as base64-string. Without a reference snapshot the floats are
+ * stored as binary block, otherwise the bits of each value are XOR-ed with the value of the reference
+ * and stored as variable-length integer: unchanged values take only one byte. The block is
+ * zlib-compressed if compress is set.
+ */
+inline std::string snapshotToBase64(const std::vector<float>& values, const std::vector<float>* ref, bool compress) {
+	std::vector<uint8_t> data;
+	if (!ref) {
+		data.resize(values.size() * sizeof(float));
+		std::memcpy(data.data(), values.data(), data.size());
+		if (compress) data = string::compress(data);
+		return string::toBase64(data.data(), data.size());
+	}
+	data.reserve(values.size() * 2);
+	for (size_t i = 0; i < values.size(); i++) {
+		uint32_t x, r = 0;
+		std::memcpy(&x, &values[i], sizeof(float));
+		if (i < ref->size()) std::memcpy(&r, &(*ref)[i], sizeof(float));
+		x ^= r;
+		while (x >= 0x80) {
+			data.push_back((x & 0x7f) | 0x80);
+			x >>= 7;
+		}
+		data.push_back(x);
+	}
+	if (compress) data = string::compress(data);
+	return string::toBase64(data.data(), data.size());
+}
+
+/** Restores the values of a snapshot encoded by snapshotToBase64(), size is the number of values of
+ * a compressed snapshot or 0 if uncompressed. Returns false on corrupt data.
+ */
+inline bool snapshotFromBase64(const std::string& str, const std::vector<float>* ref, std::vector<float>& values, size_t size) {
+	std::vector<uint8_t> data;
+	values.clear();
+	try {
+		data = string::fromBase64(str);
+		if (size > 0) {
+			// A variable-length integer takes at most five bytes
+			std::vector<uint8_t> z = std::move(data);
+			size_t len = size * (ref ? 5 : sizeof(float));
+			data.resize(len);
+			string::uncompress(z, data.data(), &len);
+			data.resize(len);
+		}
+	}
+	catch (std::exception&) {
+		return false;
+	}
+	if (!ref) {
+		if (data.size() % sizeof(float) != 0) return false;
+		values.resize(data.size() / sizeof(float));
+		std::memcpy(values.data(), data.data(), values.size() * sizeof(float));
+		return size == 0 || values.size() == size;
+	}
+	values.reserve(ref->size());
+	size_t p = 0;
+	while (p < data.size()) {
+		uint32_t x = 0;
+		int shift = 0;
+		while (p < data.size()) {
+			uint8_t b = data[p++];
+			x |= (uint32_t)(b & 0x7f) << shift;
+			shift += 7;
+			if (!(b & 0x80)) break;
+		}
+		uint32_t r = 0;
+		size_t i = values.size();
+		if (i < ref->size()) std::memcpy(&r, &(*ref)[i], sizeof(float));
+		x ^= r;
+		float v;
+		std::memcpy(&v, &x, sizeof(float));
+		values.push_back(v);
+	}
+	return size == 0 || values.size() == size;
+}
+
 template <int NUM_PRESETS>
 struct TransitBase : Module, StripIdFixModule {
 	/** [Stored to JSON] */
@@ -49,6 +126,8 @@ struct TransitBase : Module, StripIdFixModule {
 	int64_t ctrlModuleId = -1;
 	int ctrlOffset = 0;
 	CTRLMODE ctrlMode = CTRLMODE::READ;
+	/** Set on expander changes within the chain, TRANSIT resolves its expanders again on the next sample */
+	bool expChainChanged = true;
 
 	TransitSlot slot[NUM_PRESETS];
 
@@ -61,17 +140,17 @@ struct TransitBase : Module, StripIdFixModule {
 		json_object_set_new(rootJ, "panelTheme", json_integer(TransitBase<NUM_PRESETS>::panelTheme));
 
 		json_t* presetsJ = json_array();
+		// Snapshots are stored relative to the previous used snapshot, see snapshotToBase64()
+		std::vector<float>* ref = NULL;
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			json_t* presetJ = json_object();
 			json_object_set_new(presetJ, "slotUsed", json_boolean(TransitBase<NUM_PRESETS>::presetSlotUsed[i]));
 			json_object_set_new(presetJ, "textLabel", json_string(TransitBase<NUM_PRESETS>::textLabel[i].c_str()));
 			if (TransitBase<NUM_PRESETS>::presetSlotUsed[i]) {
-				json_t* slotJ = json_array();
-				for (size_t j = 0; j < TransitBase<NUM_PRESETS>::preset[i].size(); j++) {
-					json_t* vJ = json_real(TransitBase<NUM_PRESETS>::preset[i][j]);
-					json_array_append_new(slotJ, vJ);
-				}
-				json_object_set(presetJ, "slot", slotJ);
+				std::string slot = snapshotToBase64(TransitBase<NUM_PRESETS>::preset[i], ref, true);
+				json_object_set_new(presetJ, ref ? "slotDeltaZ" : "slotBinZ", json_string(slot.c_str()));
+				json_object_set_new(presetJ, "slotSize", json_integer(TransitBase<NUM_PRESETS>::preset[i].size()));
+				ref = &TransitBase<NUM_PRESETS>::preset[i];
 			}
 			json_array_append_new(presetsJ, presetJ);
 		}
@@ -86,24 +165,74 @@ struct TransitBase : Module, StripIdFixModule {
 		json_t* presetsJ = json_object_get(rootJ, "presets");
 		json_t* presetJ;
 		size_t presetIndex;
+		// Delta-encoded snapshots depend on the previous used slot, once a slot can't be decoded all
+		// following delta-encoded slots are dropped too until the next fully stored slot
+		std::vector<float>* ref = NULL;
+		int dropped = 0;
 		json_array_foreach(presetsJ, presetIndex, presetJ) {
+			if (presetIndex >= NUM_PRESETS) break;
 			presetSlotUsed[presetIndex] = json_boolean_value(json_object_get(presetJ, "slotUsed"));
 			json_t* textLabelJ = json_object_get(presetJ, "textLabel");
 			if (textLabelJ) textLabel[presetIndex] = json_string_value(textLabelJ);
 			preset[presetIndex].clear();
 			if (presetSlotUsed[presetIndex]) {
-				json_t* slotJ = json_object_get(presetJ, "slot");
-				json_t* vJ;
-				size_t j;
-				json_array_foreach(slotJ, j, vJ) {
-					float v = json_real_value(vJ);
-					preset[presetIndex].push_back(v);
+				// "slotBin" and "slotDelta" hold the same data uncompressed
+				size_t slotSize = std::max((json_int_t)0, json_integer_value(json_object_get(presetJ, "slotSize")));
+				const char* slotBinZ = json_string_value(json_object_get(presetJ, "slotBinZ"));
+				const char* slotDeltaZ = json_string_value(json_object_get(presetJ, "slotDeltaZ"));
+				const char* slotBin = json_string_value(json_object_get(presetJ, "slotBin"));
+				const char* slotDelta = json_string_value(json_object_get(presetJ, "slotDelta"));
+				bool ok = true;
+				if (slotBinZ && slotSize > 0) {
+					ok = snapshotFromBase64(slotBinZ, NULL, preset[presetIndex], slotSize);
 				}
+				else if (slotDeltaZ && slotSize > 0) {
+					ok = ref && snapshotFromBase64(slotDeltaZ, ref, preset[presetIndex], slotSize);
+				}
+				else if (slotBin) {
+					ok = snapshotFromBase64(slotBin, NULL, preset[presetIndex], 0);
+				}
+				else if (slotDelta) {
+					ok = ref && snapshotFromBase64(slotDelta, ref, preset[presetIndex], 0);
+				}
+				else {
+					// Format used before v2.0.0
+					json_t* slotJ = json_object_get(presetJ, "slot");
+					json_t* vJ;
+					size_t j;
+					json_array_foreach(slotJ, j, vJ) {
+						float v = json_real_value(vJ);
+						preset[presetIndex].push_back(v);
+					}
+				}
+				if (!ok) {
+					presetSlotUsed[presetIndex] = false;
+					preset[presetIndex].clear();
+					ref = NULL;
+					dropped++;
+					continue;
+				}
+				ref = &preset[presetIndex];
 			}
 		}
+		if (dropped > 0) {
+			WARN("TRANSIT: %i snapshots could not be decoded and have been dropped", dropped);
+		}
 	}
 };
 
+/** Flags TRANSIT on the left end of the expander-chain containing m for resolving the chain again.
+ * Must be called from the engine thread, e.g. from onExpanderChange() or onRemove().
+ */
+template <int NUM_PRESETS>
+void expanderChainChanged(Module* m) {
+	while (m && (m->model == modelTransitEx || m->model == modelTransit)) {
+		reinterpret_cast<TransitBase<NUM_PRESETS>*>(m)->expChainChanged = true;
+		if (m->model == modelTransit) break;
+		m = m->leftExpander.module;
+	}
+}
+
 template <int NUM_PRESETS>
 struct TransitParamQuantity : ParamQuantity {
 	int id;
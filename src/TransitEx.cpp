@@ -56,6 +56,15 @@ struct TransitExModule : TransitBase<NUM_PRESETS> {
 		}
     }
 
+	void onExpanderChange(const Module::ExpanderChangeEvent& e) override {
+		expanderChainChanged<NUM_PRESETS>(this);
+	}
+
+	void onRemove() override {
+		// Rack doesn't send an ExpanderChangeEvent to the neighbours of a removed module
+		expanderChainChanged<NUM_PRESETS>(Module::leftExpander.module);
+	}
+
 	TransitSlot* transitSlot(int i) override {
 		return &BASE::slot[i];
 	}
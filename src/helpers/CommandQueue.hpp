@@ -0,0 +1,82 @@
+#pragma once
+#include "../plugin.hpp"
+#include <atomic>
+#include <type_traits>
+
+namespace StoermelderPackOne {
+
+/**
+ * Lock-free queue of fixed-size commands for a single producer and a single consumer, usually
+ * the engine-thread and the UI-thread. Commands are copied by value, so neither side allocates.
+ * Commands which don't fit into the queue are dropped and counted, the producer doesn't log as it
+ * might be the engine-thread: reporting is up to the consumer, see overflow().
+ * Commands changing state which must not get lost are pushed by pushSticky() instead.
+ */
+template<typename COMMAND, size_t CAPACITY = 16>
+struct CommandQueue {
+	static_assert(std::is_trivially_copyable<COMMAND>::value, "Commands must be trivially copyable");
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+	COMMAND data[CAPACITY];
+	/** Written by the consumer only */
+	std::atomic<size_t> start{0};
+	/** Written by the producer only */
+	std::atomic<size_t> end{0};
+	/** Number of commands dropped as the queue was full */
+	std::atomic<uint32_t> overflowCount{0};
+	/** Number of dropped commands already returned by overflow(), consumer only */
+	uint32_t overflowReported = 0;
+	/** Commands pushed by pushSticky(), one bit per value of COMMAND */
+	std::atomic<uint32_t> sticky{0};
+
+	/** Returns false if the command has been dropped, producer only */
+	bool push(const COMMAND& c) {
+		size_t e = end.load(std::memory_order_relaxed);
+		if (e - start.load(std::memory_order_acquire) >= CAPACITY) {
+			overflowCount.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		data[e & (CAPACITY - 1)] = c;
+		end.store(e + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Sets a command which is never dropped, it is pending at most once no matter how often it is pushed.
+	 * Sticky commands are processed before the queued ones in order of their values. COMMAND must be
+	 * an enum with values below 32. Can be called from any thread.
+	 */
+	void pushSticky(COMMAND c) {
+		sticky.fetch_or(1u << (uint32_t)c, std::memory_order_release);
+	}
+
+	bool empty() {
+		return sticky.load(std::memory_order_acquire) == 0 && start.load(std::memory_order_acquire) == end.load(std::memory_order_acquire);
+	}
+
+	/** Returns the number of commands dropped since the last call, consumer only */
+	uint32_t overflow() {
+		uint32_t n = overflowCount.load(std::memory_order_relaxed);
+		uint32_t d = n - overflowReported;
+		overflowReported = n;
+		return d;
+	}
+
+	/** Calls f for every command in order of submission, sticky commands first, consumer only */
+	template<typename F>
+	void process(F f) {
+		uint32_t st = sticky.exchange(0, std::memory_order_acquire);
+		for (uint32_t i = 0; st != 0; i++, st >>= 1) {
+			if (st & 1) f((COMMAND)i);
+		}
+		size_t s = start.load(std::memory_order_relaxed);
+		size_t e = end.load(std::memory_order_acquire);
+		while (s != e) {
+			COMMAND c = data[s & (CAPACITY - 1)];
+			start.store(++s, std::memory_order_release);
+			f(c);
+		}
+	}
+}; // struct CommandQueue
+
+} // namespace StoermelderPackOne
@@ -0,0 +1,96 @@
+#pragma once
+#include "../plugin.hpp"
+#include <atomic>
+
+namespace StoermelderPackOne {
+
+/**
+ * Histogram of recall latencies on a logarithmic scale. Recording is lock-free and can be done
+ * from any thread, reading is meant for the UI and might observe a partially recorded value.
+ */
+struct LatencyHistogram {
+	static const int NUM_BINS = 10;
+	/** Upper limits of the bins in milliseconds, the last bin holds all larger values */
+	const float binLimits[NUM_BINS - 1] = { 0.1f, 0.3f, 1.f, 3.f, 10.f, 30.f, 100.f, 300.f, 1000.f };
+
+	std::atomic<uint32_t> bins[NUM_BINS];
+	std::atomic<uint32_t> count;
+	/** Sum and maximum in microseconds */
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> max;
+
+	LatencyHistogram() {
+		reset();
+	}
+
+	void reset() {
+		for (int i = 0; i < NUM_BINS; i++) {
+			bins[i] = 0;
+		}
+		count = 0;
+		sum = 0;
+		max = 0;
+	}
+
+	/** Records a latency given in seconds */
+	void add(double t) {
+		float ms = std::max(t, 0.0) * 1000.0;
+		int i = 0;
+		while (i < NUM_BINS - 1 && ms > binLimits[i]) i++;
+		bins[i]++;
+		count++;
+		uint64_t us = uint64_t(ms * 1000.f);
+		sum += us;
+		uint64_t m = max;
+		while (us > m && !max.compare_exchange_weak(m, us));
+	}
+
+	std::string binLabel(int i) {
+		if (i == 0) return string::f("≤ %g ms", binLimits[0]);
+		if (i == NUM_BINS - 1) return string::f("> %g ms", binLimits[NUM_BINS - 2]);
+		return string::f("%g – %g ms", binLimits[i - 1], binLimits[i]);
+	}
+
+	std::string summary() {
+		uint32_t c = count;
+		if (c == 0) return "No recalls";
+		return string::f("n=%u, mean %.2f ms, max %.2f ms", c, sum / 1000.0 / c, max / 1000.0);
+	}
+
+	/** Tab-separated text for export */
+	std::string toString() {
+		std::string s = "bin\tcount\n";
+		for (int i = 0; i < NUM_BINS; i++) {
+			s += string::f("%s\t%u\n", binLabel(i).c_str(), (uint32_t)bins[i]);
+		}
+		s += string::f("total\t%u\n", (uint32_t)count);
+		s += string::f("mean (ms)\t%.3f\n", count > 0 ? sum / 1000.0 / count : 0.0);
+		s += string::f("max (ms)\t%.3f\n", max / 1000.0);
+		return s;
+	}
+}; // struct LatencyHistogram
+
+/** Submenu showing the histogram with options for export and reset. */
+inline MenuItem* createLatencyMenuItem(std::string text, LatencyHistogram* h) {
+	return createSubmenuItem(text, "",
+		[=](Menu* menu) {
+			menu->addChild(createMenuLabel(h->summary()));
+			if (h->count > 0) {
+				for (int i = 0; i < LatencyHistogram::NUM_BINS; i++) {
+					uint32_t c = h->bins[i];
+					if (c == 0) continue;
+					menu->addChild(createMenuLabel(string::f("%s: %u", h->binLabel(i).c_str(), c)));
+				}
+			}
+			menu->addChild(new MenuSeparator);
+			menu->addChild(createMenuItem("Copy to clipboard", "",
+				[=]() { glfwSetClipboardString(APP->window->win, h->toString().c_str()); }
+			));
+			menu->addChild(createMenuItem("Reset", "",
+				[=]() { h->reset(); }
+			));
+		}
+	);
+}
+
+} // namespace StoermelderPackOne
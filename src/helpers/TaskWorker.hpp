@@ -1,51 +1,150 @@
 #pragma once
 #include "../plugin.hpp"
+#include "WorkerPool.hpp"
 #include <functional>
 #include <mutex>
 #include <condition_variable>
 
 namespace StoermelderPackOne {
 
+/**
+ * Runs tasks of one owner on the plugin-wide worker pool, one after the other in order of submission.
+ * A task which has not been started yet is replaced by the next one submitted, so the latest task
+ * always runs and never races with the previous one. No thread is held while no task is pending.
+ * The engine-thread must not submit tasks as this locks and allocates, it calls post() instead.
+ */
 struct TaskWorker {
 	std::mutex workerMutex;
-	std::condition_variable workerCondVar;
-	std::thread* worker;
-	Context* workerContext;
-	bool workerIsRunning = true;
-	bool workerDoProcess = false;
-	int workerPreset = -1;
+	std::condition_variable workerDoneCondVar;
 	std::function<void()> workerTask;
+	/** Number of the latest task submitted */
+	uint64_t workerTaskId = 0;
+	/** Number of the latest task completed, replaced tasks count as completed */
+	uint64_t workerTaskDone = 0;
+	/** A job of this worker is running tasks on the pool */
+	bool workerIsRunning = false;
+	/** Number of jobs of this worker submitted to the pool and not finished yet */
+	int workerJobs = 0;
+	/** A prioritized job of this worker is waiting on the pool */
+	bool workerPriorityJob = false;
+	/** Runs the function set by postTask() on the pool's dispatcher-thread */
+	WorkerPool::Notifier postNotifier;
+	bool postRegistered = false;
 
 	TaskWorker() {
-		workerContext = contextGet();
-		worker = new std::thread(&TaskWorker::processWorker, this);
+		// The pool's threads inherit the context of the thread creating the pool
+		workerPool();
 	}
 
 	~TaskWorker() {
-		workerIsRunning = false;
-		workerDoProcess = true;
-		workerCondVar.notify_one();
-		worker->join();
-		workerContext = NULL;
-		delete worker;
-	}
-
-	void processWorker() {
-		contextSet(workerContext);
-		while (true) {
-			std::unique_lock<std::mutex> lock(workerMutex);
-			workerCondVar.wait(lock, std::bind(&TaskWorker::workerDoProcess, this));
-			if (!workerIsRunning) return;
-			workerTask();
-			workerDoProcess = false;
+		postStop();
+		std::unique_lock<std::mutex> lock(workerMutex);
+		workerDoneCondVar.wait(lock, [this]() { return workerJobs == 0; });
+	}
+
+	void processWorker(bool priority) {
+		std::unique_lock<std::mutex> lock(workerMutex);
+		if (priority) workerPriorityJob = false;
+		// Another job is already running the tasks of this worker
+		if (!workerIsRunning) {
+			workerIsRunning = true;
+			while (workerTask) {
+				std::function<void()> task = std::move(workerTask);
+				workerTask = nullptr;
+				uint64_t taskId = workerTaskId;
+				lock.unlock();
+				task();
+				lock.lock();
+				workerTaskDone = taskId;
+				workerDoneCondVar.notify_all();
+			}
+			workerIsRunning = false;
+		}
+		workerJobs--;
+		// Notify while locked, the worker might be destroyed as soon as the lock is released
+		workerDoneCondVar.notify_all();
+	}
+
+	/** Must be called with workerMutex locked, returns true if a job must be submitted to the pool */
+	bool workerSchedule(bool priority) {
+		// A running job picks up the new task when the current one has completed
+		if (workerIsRunning) return false;
+		// A prioritized task must not wait behind other jobs of the pool
+		if (workerJobs == 0 || (priority && !workerPriorityJob)) {
+			workerJobs++;
+			if (priority) workerPriorityJob = true;
+			return true;
+		}
+		return false;
+	}
+
+	uint64_t workerSubmit(std::function<void()>& task, bool priority, bool ifIdle) {
+		uint64_t taskId;
+		bool schedule;
+		{
+			std::lock_guard<std::mutex> lock(workerMutex);
+			if (ifIdle && workerTask) return 0;
+			workerTask = task;
+			taskId = ++workerTaskId;
+			schedule = workerSchedule(priority);
+		}
+		if (schedule) {
+			workerPool().submit([this, priority]() { processWorker(priority); }, priority);
 		}
+		return taskId;
+	}
+
+	/**
+	 * Submits a task, returns its number for use with isDone() and wait().
+	 * Time-critical tasks should be prioritized, they are started before waiting jobs of other modules.
+	 */
+	uint64_t work(std::function<void()> task, bool priority = false) {
+		return workerSubmit(task, priority, false);
+	}
+
+	/** Submits a task only if no other task is waiting to be started, returns 0 if the task has been dropped */
+	uint64_t workIfIdle(std::function<void()> task, bool priority = false) {
+		return workerSubmit(task, priority, true);
+	}
+
+	/**
+	 * Sets the function run on each post(), which usually submits tasks by work(). State for the tasks
+	 * is handed over by atomics, must be called once before post() is used.
+	 */
+	void postTask(std::function<void()> f) {
+		postNotifier.f = f;
+		workerPool().addNotifier(&postNotifier);
+		postRegistered = true;
+	}
+
+	/** Requests the function set by postTask() without locking or allocating, usually from the engine-thread */
+	void post() {
+		workerPool().notify(&postNotifier);
+	}
+
+	/** Stops the function set by postTask(), blocks until it has completed if it is running */
+	void postStop() {
+		if (!postRegistered) return;
+		postRegistered = false;
+		workerPool().removeNotifier(&postNotifier);
+	}
+
+	bool isDone(uint64_t taskId) {
+		std::lock_guard<std::mutex> lock(workerMutex);
+		return workerTaskDone >= taskId;
+	}
+
+	/** Blocks until the task and all tasks submitted before have completed */
+	void wait(uint64_t taskId) {
+		std::unique_lock<std::mutex> lock(workerMutex);
+		workerDoneCondVar.wait(lock, [&]() { return workerTaskDone >= taskId; });
 	}
 
-	void work(std::function<void()> task) {
-		workerTask = task;
-		workerDoProcess = true;
-		workerCondVar.notify_one();
+	/** Blocks until all tasks submitted have completed */
+	void wait() {
+		std::unique_lock<std::mutex> lock(workerMutex);
+		workerDoneCondVar.wait(lock, [this]() { return workerTaskDone >= workerTaskId; });
 	}
 }; // struct TaskWorker
 
-} // namespace StoermelderPackOne
\ No newline at end of file
+} // namespace StoermelderPackOne
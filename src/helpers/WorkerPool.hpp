@@ -0,0 +1,136 @@
+#pragma once
+#include "../plugin.hpp"
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace StoermelderPackOne {
+
+/**
+ * Small pool of threads shared by all modules of the plugin. Jobs are started in order of submission,
+ * prioritized jobs before all others.
+ * Threads which must neither block nor allocate, such as the engine-thread, can't submit jobs. They
+ * notify a Notifier instead, its function is run on the pool's dispatcher-thread.
+ */
+struct WorkerPool {
+	/** Function run on the dispatcher-thread once notified, notifications are coalesced until it runs */
+	struct Notifier {
+		std::function<void()> f;
+		std::atomic<bool> pending{false};
+	};
+
+	std::mutex poolMutex;
+	std::condition_variable poolCondVar;
+	std::vector<std::thread*> threads;
+	std::deque<std::function<void()>> jobs;
+	std::deque<std::function<void()>> priorityJobs;
+	Context* poolContext;
+	bool poolIsRunning = true;
+
+	std::mutex notifyMutex;
+	std::condition_variable notifyCondVar;
+	std::vector<Notifier*> notifiers;
+	std::atomic<bool> notifyPending{false};
+	std::thread* notifyThread;
+	bool notifyIsRunning = true;
+
+	WorkerPool(int threadCount) {
+		poolContext = contextGet();
+		for (int i = 0; i < threadCount; i++) {
+			threads.push_back(new std::thread(&WorkerPool::processWorker, this));
+		}
+		notifyThread = new std::thread(&WorkerPool::processNotify, this);
+	}
+
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(notifyMutex);
+			notifyIsRunning = false;
+		}
+		notifyCondVar.notify_all();
+		notifyThread->join();
+		delete notifyThread;
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			poolIsRunning = false;
+		}
+		poolCondVar.notify_all();
+		for (std::thread* t : threads) {
+			t->join();
+			delete t;
+		}
+		poolContext = NULL;
+	}
+
+	void processWorker() {
+		contextSet(poolContext);
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(poolMutex);
+				poolCondVar.wait(lock, [this]() { return !poolIsRunning || !priorityJobs.empty() || !jobs.empty(); });
+				if (!poolIsRunning) return;
+				std::deque<std::function<void()>>& q = !priorityJobs.empty() ? priorityJobs : jobs;
+				job = std::move(q.front());
+				q.pop_front();
+			}
+			job();
+		}
+	}
+
+	void submit(std::function<void()> job, bool priority = false) {
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			(priority ? priorityJobs : jobs).push_back(std::move(job));
+		}
+		poolCondVar.notify_one();
+	}
+
+	void processNotify() {
+		contextSet(poolContext);
+		std::unique_lock<std::mutex> lock(notifyMutex);
+		while (true) {
+			// notify() doesn't wait for the mutex, so a notification might come in between checking and
+			// waiting: the timeout limits the delay in this rare case
+			notifyCondVar.wait_for(lock, std::chrono::milliseconds(10), [this]() { return !notifyIsRunning || notifyPending; });
+			if (!notifyIsRunning) return;
+			if (!notifyPending.exchange(false, std::memory_order_acquire)) continue;
+			for (Notifier* n : notifiers) {
+				if (n->pending.exchange(false, std::memory_order_acquire)) n->f();
+			}
+		}
+	}
+
+	void addNotifier(Notifier* n) {
+		std::lock_guard<std::mutex> lock(notifyMutex);
+		notifiers.push_back(n);
+	}
+
+	/** Blocks until the function of the notifier has completed if it is running */
+	void removeNotifier(Notifier* n) {
+		std::lock_guard<std::mutex> lock(notifyMutex);
+		notifiers.erase(std::remove(notifiers.begin(), notifiers.end(), n), notifiers.end());
+	}
+
+	/** Requests to run the function of the notifier, doesn't block or allocate */
+	void notify(Notifier* n) {
+		n->pending.store(true, std::memory_order_release);
+		notifyPending.store(true, std::memory_order_release);
+		// The notification can't get lost if the mutex is free, otherwise the dispatcher-thread is
+		// most likely running and checks again before waiting
+		std::unique_lock<std::mutex> lock(notifyMutex, std::try_to_lock);
+		notifyCondVar.notify_one();
+	}
+}; // struct WorkerPool
+
+/** Plugin-wide instance, created on first use */
+inline WorkerPool& workerPool() {
+	static WorkerPool pool(clamp((int)std::thread::hardware_concurrency() - 1, 1, 4));
+	return pool;
+}
+
+} // namespace StoermelderPackOne